@@ -0,0 +1,67 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Helpers for the bulk-load path of addAll() in the OrcGC sets.
+ *
+ * When the set is empty, addAll() sorts the keys, builds the whole structure privately and then
+ * publishes it with a single CAS, instead of doing one add() per key:
+ * - The nodes are created with make_orc_unpublished(), which sets the counter of each node to the
+ *   number of links that will point to it, and the links are stored with orc_atomic<T>::init(),
+ *   therefore there is no atomic increment, no hazardous pointer and no CAS per node.
+ * - The first node (or the root) is created with make_orc() and held by an orc_ptr, so that if the
+ *   publishing CAS fails, the whole structure is reclaimed when the orc_ptr goes out of scope, and
+ *   addAll() falls back to calling add() for each key.
+ * - All the nodes are created by the calling thread. With more than BULK_PARALLEL_MIN keys, they
+ *   are then linked by up to BULK_MAX_THREADS threads, each on its own contiguous chunk. The helper
+ *   threads must not call ThreadRegistry::getTID() (make_orc(), make_orc_unpublished(), load(), ...):
+ *   a registered tid is never given back to maxTid, and every scan of OrcGC would cover its row
+ *   for the rest of the process.
+ *
+ * None of this is lock-free: addAll() is meant to fill a set before it is shared.
+ */
+static const int BULK_PARALLEL_MIN = 1 << 16;  // Minimum number of items per thread
+static const int BULK_MAX_THREADS = 16;
+
+// Returns the pointers in 'keys' sorted by key, without duplicates. K doesn't need to be assignable
+template<typename K>
+std::vector<K*> bulkSortedUnique(K** keys, const int size) {
+    std::vector<K*> sorted(keys, keys + size);
+    std::sort(sorted.begin(), sorted.end(), [](const K* a, const K* b) { return *a < *b; });
+    auto last = std::unique(sorted.begin(), sorted.end(), [](const K* a, const K* b) { return !(*a < *b); });
+    sorted.erase(last, sorted.end());
+    return sorted;
+}
+
+// Calls func(begin, end) on disjoint chunks that cover [0,n), in parallel if n is large enough.
+// 'func' must not register the helper threads in the ThreadRegistry
+template<typename F>
+void bulkParallelFor(const int n, F func) {
+    int numThreads = std::min<int>(n / BULK_PARALLEL_MIN, BULK_MAX_THREADS);
+    numThreads = std::min<int>(numThreads, std::thread::hardware_concurrency());
+    if (numThreads <= 1) {
+        if (n > 0) func(0, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    const int chunk = (n + numThreads - 1) / numThreads;
+    for (int it = 1; it < numThreads; it++) {
+        const int begin = std::min(it*chunk, n);
+        const int end = std::min(begin + chunk, n);
+        workers.emplace_back([&func, begin, end] { func(begin, end); });
+    }
+    func(0, std::min(chunk, n));
+    for (auto& w : workers) w.join();
+}
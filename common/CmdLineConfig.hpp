@@ -9,6 +9,7 @@
 #pragma once
 #include <algorithm>
 #include <vector>
+#include <string>
 #include <stdio.h>
 #include <cstdint>
 #include <cstring>
@@ -21,6 +22,14 @@ struct CmdLineConfig {
     uint64_t runs               {1};                          // Number of runs
     std::vector<int> threads = {1,2,4,8,10,16,20,24,32,40};   // List of threads
     std::vector<int> ratios = {1000,100,10};                  // List of ratios (in permil)
+    bool pool                  {false};                      // Use the per-thread OrcPool in make_orc<T>()
+    bool hugepages             {false};                      // Take the OrcPool slabs from 2MB huge pages (implies pool)
+    uint64_t memsample          {0};                          // Period (in ms) of the memory samples, zero to disable
+    bool latency               {false};                      // Time each operation and save the latency percentiles
+    std::vector<long long> rates;                             // Target rates (ops/sec) of the open-loop set benchmark, empty for closed-loop
+    std::string dist          {"uniform"};                  // Key distribution of the set benchmarks (see graphs/KeyDistribution.hpp)
+    uint64_t batch              {0};                          // Items per enqueueBatch()/dequeueBatch() in the queue benchmarks, zero to disable
+    bool bulk                  {false};                      // Fill the sets with addAll() (bulk load) instead of one add() per key
 
     CmdLineConfig() {
     }
@@ -36,6 +45,14 @@ struct CmdLineConfig {
                 printf("--runs=1             Number of runs. Result is the median of all runs\n");
                 printf("--threads=1,2,4      Comma separated values with the number of threads\n");
                 printf("--ratios=1000,100,0  Comma separated ratios (1000=100%% writes, 100=10%% writes and 90%% reads)\n");
+                printf("--pool               Allocate OrcGC objects from per-thread pools instead of 'new'\n");
+                printf("--hugepages          Same as --pool but the pools take their memory from 2MB huge pages\n");
+                printf("--memsample=10       Sample the RSS and the OrcGC live objects every 10 ms, into data/<benchmark>-mem.txt\n");
+                printf("--latency            Time each operation and save the percentiles into data/<benchmark>-latency.txt\n");
+                printf("--rates=1000000,2000000  Run the set benchmarks open-loop at each of these rates (ops/sec of all threads)\n");
+                printf("--dist=uniform       Key distribution of the set benchmarks: uniform, zipf:0.99 or hotspot:0.9,0.01\n");
+                printf("--batch=16           Also run the queue benchmarks with enqueueBatch()/dequeueBatch() of 16 items\n");
+                printf("--bulk               Fill the sets with addAll() instead of one add() per key\n");
                 return false;
             }
             //printf("this: [%s]\n", strstr(argv[iarg], "--num="));
@@ -74,8 +91,60 @@ struct CmdLineConfig {
                 }
                 continue;
             }
+            if (strstr(argv[iarg], "--memsample=") != NULL) {
+                memsample = atoi(argv[iarg]+strlen("--memsample="));
+                continue;
+            }
+            if (strstr(argv[iarg], "--batch=") != NULL) {
+                batch = atoi(argv[iarg]+strlen("--batch="));
+                continue;
+            }
+            if (strstr(argv[iarg], "--dist=") != NULL) {
+                dist = argv[iarg]+strlen("--dist=");
+                continue;
+            }
+            if (strstr(argv[iarg], "--rates=") != NULL) {
+                rates.clear();
+                char* args = argv[iarg]+strlen("--rates=");
+                args = strtok(args, ",");
+                while (args != NULL) {
+                    char* end;
+                    const long long rate = strtoll(args, &end, 10);
+                    if (*end != '\0' || rate <= 0) printf("ERROR: invalid rate '%s', ignored\n", args);
+                    else rates.push_back(rate);
+                    args = strtok(NULL, ",");
+                }
+                continue;
+            }
+            if (strcmp("--bulk",argv[iarg]) == 0) {
+                bulk = true;
+                continue;
+            }
+            if (strcmp("--latency",argv[iarg]) == 0) {
+                latency = true;
+                continue;
+            }
+            if (strcmp("--pool",argv[iarg]) == 0) {
+                pool = true;
+                continue;
+            }
+            if (strcmp("--hugepages",argv[iarg]) == 0) {
+                pool = true;
+                hugepages = true;
+                continue;
+            }
             printf("Unknow configuration parameter: [%s]\n", argv[iarg]);
         }
+        // The open-loop threads issue one operation every numThreads/rate seconds, which must be at least one nanosecond
+        if (!rates.empty() && !threads.empty()) {
+            const long long maxRate = 1000000000LL * *std::min_element(threads.begin(), threads.end());
+            auto tooHigh = [maxRate](const long long rate) {
+                if (rate <= maxRate) return false;
+                printf("ERROR: rate %lld is above 1 op/ns per thread (%lld with the fewest threads), ignored\n", rate, maxRate);
+                return true;
+            };
+            rates.erase(std::remove_if(rates.begin(), rates.end(), tooHigh), rates.end());
+        }
 
         return true;
     }
@@ -83,13 +152,24 @@ struct CmdLineConfig {
     void print() {
         printf("Configuration: num=%ld  duration=%ld  runs=%ld  ", keys, duration, runs);
         printf("threads=");
-        for (int i = 0; i < threads.size(); i++) {
+        for (unsigned i = 0; i < threads.size(); i++) {
             printf("%d,", threads[i]);
         }
         printf("  ratios=");
-        for (int i = 0; i < ratios.size(); i++) {
+        for (unsigned i = 0; i < ratios.size(); i++) {
             printf("%.1f%%,", (float)ratios[i]/10.);
         }
+        if (pool) printf("  pool");
+        if (hugepages) printf("  hugepages");
+        if (memsample) printf("  memsample=%ldms", memsample);
+        if (latency) printf("  latency");
+        if (dist != "uniform") printf("  dist=%s", dist.c_str());
+        if (batch) printf("  batch=%ld", batch);
+        if (bulk) printf("  bulk");
+        if (!rates.empty()) {
+            printf("  rates=");
+            for (unsigned i = 0; i < rates.size(); i++) printf("%lld,", rates[i]);
+        }
         printf("\n");
     }
 
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+/*
+ * Layout policies for the nodes of the data structures.
+ * They are passed as the 'Layout' template parameter and the nodes are declared
+ * with alignas(Layout::nodeAlign).
+ *
+ * PaddedLayout:    Each node is aligned (and therefore padded) to 128 bytes, two cache lines,
+ *                  to avoid false sharing between nodes. This was always the default.
+ * CacheLineLayout: Each node is aligned to a single cache line of 64 bytes.
+ * CompactLayout:   No padding. Nodes are as small as their members allow, which reduces
+ *                  the memory footprint and TLB misses of large read-mostly data structures.
+ *
+ * Data structures that are always contended (like the queues) keep their nodes padded.
+ */
+struct PaddedLayout {
+    static const std::size_t nodeAlign = 128;
+    static std::string suffix() { return ""; }
+};
+
+struct CacheLineLayout {
+    static const std::size_t nodeAlign = 64;
+    static std::string suffix() { return "-CacheLine"; }
+};
+
+struct CompactLayout {
+    static const std::size_t nodeAlign = alignof(void*);
+    static std::string suffix() { return "-Compact"; }
+};
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include <string>
+
+
+/*
+ * Level generators for the skiplists.
+ * They are passed as the 'Level' template parameter: the skiplist has Level::maxLevel+1
+ * levels and each new node gets a height of Level::randomLevel(), in [0,maxLevel].
+ *
+ * XorshiftLevel:  Each thread has its own xorshift generator, and the level is the number of
+ *                 trailing zeros of a random word, divided by log2(BRANCHING), which gives a
+ *                 geometric distribution with p = 1/BRANCHING without any division or log().
+ *                 maxLevel is the smallest L such that BRANCHING^L >= EXPECTED_KEYS.
+ *                 The defaults give the same distribution and number of levels as LibcRandLevel.
+ * LibcRandLevel:  The original generator, which uses log() and the global rand(). In glibc,
+ *                 rand() takes a lock, therefore this serializes concurrent inserts.
+ */
+constexpr int skiplistMaxLevel(uint64_t branching, uint64_t expectedKeys) {
+    int lvl = 1;
+    for (uint64_t n = branching; n < expectedKeys && lvl < 63; n *= branching) lvl++;
+    return lvl;
+}
+
+template<uint64_t BRANCHING = 2, uint64_t EXPECTED_KEYS = (1ULL << 16)>
+struct XorshiftLevel {
+    static_assert(BRANCHING >= 2 && (BRANCHING & (BRANCHING-1)) == 0, "BRANCHING must be a power of two");
+    static const int maxLevel = skiplistMaxLevel(BRANCHING, EXPECTED_KEYS);
+    static const int log2Branching = __builtin_ctzll(BRANCHING);
+
+    static int randomLevel() {
+        static std::atomic<uint64_t> seeds {0};
+        static thread_local uint64_t x = 0;
+        if (x == 0) {
+            // splitmix64 of a per-thread sequence number, never zero
+            uint64_t z = seeds.fetch_add(0x9E3779B97F4A7C15ULL) + 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            x = (z ^ (z >> 31)) | 1;
+        }
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        const int lvl = __builtin_ctzll(x) / log2Branching;
+        return lvl < maxLevel ? lvl : maxLevel;
+    }
+
+    static std::string suffix() {
+        if (BRANCHING == 2 && EXPECTED_KEYS == (1ULL << 16)) return "";
+        return "-B" + std::to_string(BRANCHING) + "-L" + std::to_string(maxLevel);
+    }
+};
+
+struct LibcRandLevel {
+    static const int maxLevel = 16;
+    static const int log2Branching = 1;
+
+    static int randomLevel() {
+        static bool first = true;
+        if (first){
+            srand((unsigned)time(nullptr));
+            first = false;
+        }
+        int lvl = (int)(log((float)rand() / RAND_MAX) / log(1.-0.5f));
+        return lvl < maxLevel ? lvl : maxLevel;
+    }
+
+    static std::string suffix() { return "-LibcRand"; }
+};
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+
+using namespace orcgc_ptp;
+
+/**
+ * <h1> Michael Hash Map with Split-Ordered buckets </h1>
+ *
+ * All the entries are kept in a single lock-free linked list of Maged Michael:
+ * http://www.cs.tau.ac.il/~afek/p73-Lock-Free-HashTbls-michael.pdf
+ * sorted in split-order, as described in Shalev and Shavit's "Split-Ordered Lists":
+ * https://dl.acm.org/doi/10.1145/1147954.1147958
+ *
+ * The bucket array holds shortcuts to dummy nodes in the list. When the number of
+ * entries goes above MAX_LOAD per bucket, the number of buckets is doubled with a
+ * single CAS and each new bucket is initialized lazily, the first time it is used,
+ * by inserting its dummy node after the dummy node of its parent bucket.
+ * No entry is ever moved and there is no stop-the-world phase.
+ *
+ * The buckets are stored in segments of SEGMENT_SIZE buckets, which are allocated on
+ * demand and de-allocated only in the destructor.
+ *
+ * The value of each entry is in a separate orc-managed object (ValNode) so that put()
+ * and replace() can swap it with a single CAS. A nullptr value means the entry was
+ * removed: this is the linearization point of remove(), after which the node is marked
+ * and unlinked like in Michael's list.
+ *
+ * The number of entries is counted with per-thread deltas, which are flushed to the
+ * global counter every COUNT_BATCH changes, therefore the load factor is approximate.
+ *
+ * <p>
+ * get(), put(), insert(), replace(), innerRemove() - Lock-Free
+ * Memory Reclamation: OrcGC
+ * <p>
+ */
+template<typename K, typename V, typename Layout = PaddedLayout, typename Hash = std::hash<K>>
+class MichaelHashMapOrcGC {
+
+private:
+    static const uint64_t SEGMENT_SIZE = 1ULL << 12;
+    static const uint64_t MAX_SEGMENTS = 1ULL << 12;
+    static const uint64_t MAX_BUCKETS = SEGMENT_SIZE*MAX_SEGMENTS;
+    static const int64_t  MAX_LOAD = 2;           // Average number of entries per bucket before doubling
+    static const int64_t  COUNT_BATCH = 64;       // Number of local changes before updating the global count
+
+    struct ValNode : public orc_base {
+        V val;
+        ValNode(V val) : val{val} { }
+    };
+
+    struct alignas(Layout::nodeAlign) Node : public orc_base {
+        uint64_t               sokey;  // Split-order key. Regular nodes have the lowest bit set, dummy nodes don't
+        K                      key;
+        orc_atomic<ValNode*>   val;
+        orc_atomic<Node*>      next;
+
+        Node(uint64_t sokey, K key, ValNode* val) : sokey{sokey}, key{key}, val{val}, next{nullptr} { }
+        void poisonAllLinks() { next.poison(); }
+    };
+
+    struct Segment {
+        orc_atomic<Node*> buckets[SEGMENT_SIZE];
+    };
+
+    struct alignas(128) LocalCount {
+        int64_t delta {0};
+    };
+
+    alignas(128) std::atomic<uint64_t> numBuckets;  // Always a power of two
+    alignas(128) std::atomic<int64_t>  count {0};
+    alignas(128) std::atomic<Segment*> segments[MAX_SEGMENTS];
+    LocalCount                         localCount[REGISTRY_MAX_THREADS];
+    Hash                               hasher {};
+
+public:
+    MichaelHashMapOrcGC(uint64_t initialBuckets=16) {
+        uint64_t nb = 1;
+        while (nb < initialBuckets && nb < MAX_BUCKETS) nb <<= 1;
+        numBuckets.store(nb, std::memory_order_relaxed);
+        for (uint64_t i = 0; i < MAX_SEGMENTS; i++) segments[i].store(nullptr, std::memory_order_relaxed);
+        // Bucket zero has the head of the list
+        getBucket(0)->store(make_orc<Node>(dummyKey(0), K{}, nullptr));
+    }
+
+
+    // We don't expect the destructor to be called if this instance can still be in use
+    ~MichaelHashMapOrcGC() {
+        for (uint64_t i = 0; i < MAX_SEGMENTS; i++) {
+            Segment* seg = segments[i].load(std::memory_order_relaxed);
+            if (seg != nullptr) delete seg;
+        }
+    }
+
+    static std::string className() { return "MichaelHashMap-OrcGC" + Layout::suffix(); }
+
+    // Size in bytes of each entry, including padding
+    static size_t nodeSize() { return sizeof(Node) + sizeof(ValNode); }
+
+
+    /**
+     * Returns the value associated with 'key', if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> get(K key) {
+        const uint64_t h = hasher(key);
+        orc_ptr<Node*> bhead = getBucketHead(h);
+        orc_ptr<Node*> prev, curr, next;
+        if (!find(bhead, regularKey(h), key, prev, curr, next)) return {};
+        orc_ptr<ValNode*> lval = curr->val.load();
+        if (lval == nullptr) return {};
+        return lval->val;
+    }
+
+
+    /**
+     * Associates 'val' with 'key' and returns the previous value, if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> put(K key, V val) {
+        const uint64_t h = hasher(key);
+        const uint64_t sokey = regularKey(h);
+        orc_ptr<ValNode*> newVal = make_orc<ValNode>(val);
+        orc_ptr<Node*> bhead = getBucketHead(h);
+        orc_ptr<Node*> newNode;
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (find(bhead, sokey, key, prev, curr, next)) {
+                orc_ptr<ValNode*> lval = curr->val.load();
+                if (lval == nullptr) {
+                    // Being removed. Help it to get out of the way and try again
+                    markNext(curr);
+                    continue;
+                }
+                if (curr->val.compare_exchange_strong(lval, newVal)) return lval->val;
+                continue;
+            }
+            if (newNode == nullptr) newNode = make_orc<Node>(sokey, key, newVal);
+            newNode->next.store(curr, std::memory_order_relaxed);
+            if (prev->next.compare_exchange_strong(curr, newNode)) {
+                addCount(1);
+                return {};
+            }
+        }
+    }
+
+
+    /**
+     * Associates 'val' with 'key' only if there is no value for 'key'.
+     * Returns true if the new entry was inserted.
+     * Progress Condition: Lock-Free
+     */
+    bool insert(K key, V val) {
+        const uint64_t h = hasher(key);
+        const uint64_t sokey = regularKey(h);
+        orc_ptr<Node*> bhead = getBucketHead(h);
+        orc_ptr<Node*> newNode;
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (find(bhead, sokey, key, prev, curr, next)) {
+                if (curr->val.load() != nullptr) return false;
+                markNext(curr);
+                continue;
+            }
+            if (newNode == nullptr) newNode = make_orc<Node>(sokey, key, make_orc<ValNode>(val));
+            newNode->next.store(curr, std::memory_order_relaxed);
+            if (prev->next.compare_exchange_strong(curr, newNode)) {
+                addCount(1);
+                return true;
+            }
+        }
+    }
+
+
+    /**
+     * Replaces the value of 'key' only if there is one, and returns the previous value
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> replace(K key, V val) {
+        const uint64_t h = hasher(key);
+        orc_ptr<ValNode*> newVal = make_orc<ValNode>(val);
+        orc_ptr<Node*> bhead = getBucketHead(h);
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (!find(bhead, regularKey(h), key, prev, curr, next)) return {};
+            orc_ptr<ValNode*> lval = curr->val.load();
+            if (lval == nullptr) return {};
+            if (curr->val.compare_exchange_strong(lval, newVal)) return lval->val;
+        }
+    }
+
+
+    /**
+     * Removes 'key' and returns its value, if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> innerRemove(K key) {
+        const uint64_t h = hasher(key);
+        const uint64_t sokey = regularKey(h);
+        orc_ptr<Node*> bhead = getBucketHead(h);
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (!find(bhead, sokey, key, prev, curr, next)) return {};
+            orc_ptr<ValNode*> lval = curr->val.load();
+            if (lval == nullptr) return {};
+            if (!curr->val.compare_exchange_strong(lval, nullptr)) continue;
+            // Logically removed. Now mark and unlink it
+            markNext(curr);
+            find(bhead, sokey, key, prev, curr, next);
+            addCount(-1);
+            return lval->val;
+        }
+    }
+
+
+    // Wrappers for the "set" benchmarks
+    bool add(K key) { return insert(key, key); }
+
+    bool remove(K key) { return innerRemove(key).has_value(); }
+
+    bool contains(K key) { return get(key).has_value(); }
+
+    // Not lock-free
+    void addAll(K** keys, const int size) {
+        for (int i = 0; i < size; i++) add(*keys[i]);
+    }
+
+
+private:
+
+    static inline uint64_t reverseBits(uint64_t x) {
+        x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        return __builtin_bswap64(x);
+    }
+
+    static inline uint64_t regularKey(uint64_t h) { return reverseBits(h) | 1ULL; }
+
+    static inline uint64_t dummyKey(uint64_t bucket) { return reverseBits(bucket) & ~1ULL; }
+
+    static inline bool isDummy(uint64_t sokey) { return (sokey & 1ULL) == 0; }
+
+    // The parent of a bucket is the same bucket without its most significant bit
+    static inline uint64_t parentBucket(uint64_t bucket) {
+        return bucket & ~(1ULL << (63 - __builtin_clzll(bucket)));
+    }
+
+    // Returns the bucket slot, allocating its segment if needed
+    orc_atomic<Node*>* getBucket(uint64_t bucket) {
+        std::atomic<Segment*>& segslot = segments[bucket / SEGMENT_SIZE];
+        Segment* seg = segslot.load();
+        if (seg == nullptr) {
+            Segment* newSeg = new Segment();
+            if (segslot.compare_exchange_strong(seg, newSeg)) {
+                seg = newSeg;
+            } else {
+                delete newSeg;
+            }
+        }
+        return &seg->buckets[bucket % SEGMENT_SIZE];
+    }
+
+    // Returns the dummy node of the bucket of hash 'h', initializing the bucket if needed
+    orc_ptr<Node*> getBucketHead(uint64_t h) {
+        const uint64_t bucket = h & (numBuckets.load() - 1);
+        orc_atomic<Node*>* slot = getBucket(bucket);
+        orc_ptr<Node*> dummy = slot->load();
+        if (dummy == nullptr) dummy = initializeBucket(bucket);
+        return dummy;
+    }
+
+    // Inserts the dummy node of 'bucket' in the list, starting from the parent bucket
+    orc_ptr<Node*> initializeBucket(uint64_t bucket) {
+        const uint64_t parent = parentBucket(bucket);
+        orc_atomic<Node*>* pslot = getBucket(parent);
+        orc_ptr<Node*> phead = pslot->load();
+        if (phead == nullptr) phead = initializeBucket(parent);
+        const uint64_t sokey = dummyKey(bucket);
+        orc_ptr<Node*> newNode;
+        orc_ptr<Node*> prev, curr, next;
+        orc_ptr<Node*> dummy;
+        while (true) {
+            if (find(phead, sokey, K{}, prev, curr, next)) {
+                // Some other thread inserted the same dummy
+                dummy = curr;
+                break;
+            }
+            if (newNode == nullptr) newNode = make_orc<Node>(sokey, K{}, nullptr);
+            newNode->next.store(curr, std::memory_order_relaxed);
+            if (prev->next.compare_exchange_strong(curr, newNode)) {
+                dummy = newNode;
+                break;
+            }
+        }
+        getBucket(bucket)->compare_exchange_strong(nullptr, dummy);
+        return dummy;
+    }
+
+    // Marks the next of 'node' so that it is unlinked by find()
+    void markNext(orc_ptr<Node*>& node) {
+        while (true) {
+            orc_ptr<Node*> lnext = node->next.load();
+            if (isMarked(lnext)) return;
+            if (node->next.compare_exchange_strong(lnext, getMarked(lnext))) return;
+        }
+    }
+
+    // Updates the per-thread count and doubles the number of buckets if the load is too high
+    void addCount(int64_t delta) {
+        LocalCount& lc = localCount[ThreadRegistry::getTID()];
+        lc.delta += delta;
+        if ((lc.delta < COUNT_BATCH) && (lc.delta > -COUNT_BATCH)) return;
+        const int64_t lcount = count.fetch_add(lc.delta) + lc.delta;
+        lc.delta = 0;
+        uint64_t nb = numBuckets.load();
+        if (lcount > (int64_t)nb*MAX_LOAD && 2*nb <= MAX_BUCKETS) numBuckets.compare_exchange_strong(nb, 2*nb);
+    }
+
+    // Order in the list: by split-order key and then by key. Dummy nodes have unique split-order keys
+    inline bool nodeLess(Node* node, uint64_t sokey, const K& key) {
+        if (node->sokey != sokey) return node->sokey < sokey;
+        return !isDummy(sokey) && node->key < key;
+    }
+
+    inline bool nodeEqual(Node* node, uint64_t sokey, const K& key) {
+        return node->sokey == sokey && (isDummy(sokey) || node->key == key);
+    }
+
+    /**
+     * Same as find() in MichaelHarrisLinkedListSetOrcGC, but starting from the dummy node of a bucket.
+     * The list ends with a nullptr instead of a tail sentinel.
+     * Progress Condition: Lock-Free
+     */
+    bool find(const orc_ptr<Node*>& start, uint64_t sokey, const K& key, orc_ptr<Node*>& prev, orc_ptr<Node*>& curr, orc_ptr<Node*>& next) {
+     try_again:
+        prev = start;
+        curr = prev->next.load();
+        while (true) {
+            if (curr == nullptr) return false;
+            next = curr->next.load();
+            Node* un_next = getUnmarked(next);
+            if (un_next == next) {
+                if (!nodeLess(curr, sokey, key)) return nodeEqual(curr, sokey, key);
+                prev = curr;
+            } else {
+                // Update the link and retire the node.
+                Node *tmp = curr;
+                if (!prev->next.compare_exchange_strong(tmp, un_next)) {
+                    if (prev->next.load() != un_next) goto try_again;
+                }
+            }
+            curr.setUnmarked(next);
+        }
+    }
+
+    bool isMarked(Node * node) {
+        return ((size_t) node & 0x1ULL);
+    }
+
+    Node * getMarked(Node * node) {
+        return (Node*)((size_t) node | 0x1ULL);
+    }
+
+    Node * getUnmarked(Node * node) {
+        return (Node*)((size_t) node & (~0x1ULL));
+    }
+};
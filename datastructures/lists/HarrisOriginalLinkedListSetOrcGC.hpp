@@ -16,6 +16,7 @@
 #include <string>
 
 #include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
 
 using namespace orcgc_ptp;
 
@@ -40,17 +41,17 @@ using namespace orcgc_ptp;
  * </ul><p>
  * <p>
  */
-template<typename T>
+template<typename T, typename Layout = PaddedLayout>
 class HarrisOriginalLinkedListSetOrcGC {
 
 private:
-    struct Node : public orc_base {
+    struct alignas(Layout::nodeAlign) Node : public orc_base {
         T key;
         orc_atomic<Node*> next {nullptr};
 
         Node(T key) : key{key} { }
         void poisonAllLinks() { next.poison(); }
-    } __attribute__((aligned(128)));
+    };
 
     // Pointers to head and tail sentinel nodes of the list
     orc_atomic<Node*> head;
@@ -70,7 +71,10 @@ public:
         head.store(nullptr);
     }
 
-    static std::string className() { return "HarrisOriginal-LinkedListSet-OrcGC" ; }
+    static std::string className() { return "HarrisOriginal-LinkedListSet-OrcGC" + Layout::suffix(); }
+
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
 
     void addAll(T** keys, const int size) {
         for(int i=0;i<size;i++){
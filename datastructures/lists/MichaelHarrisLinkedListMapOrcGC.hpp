@@ -0,0 +1,244 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <string>
+
+#include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+
+using namespace orcgc_ptp;
+
+/**
+ * Map version of MichaelHarrisLinkedListSetOrcGC.
+ * Lock-Free Linked List as described in Maged M. Michael paper (Figure 4):
+ * http://www.cs.tau.ac.il/~afek/p73-Lock-Free-HashTbls-michael.pdf
+ *
+ * The value of each entry is in a separate orc-managed object (ValNode) so that put()
+ * and replace() swap it with a single CAS, without removing and re-inserting the node.
+ * A nullptr value means the entry was removed: this is the linearization point of
+ * remove(), after which the node is marked and unlinked like in the set.
+ *
+ * <p>
+ * get(), put(), putIfAbsent(), insert(), replace(), innerRemove() - Lock-Free
+ * Memory Reclamation: OrcGC
+ * <p>
+ */
+template<typename K, typename V, typename Layout = PaddedLayout>
+class MichaelHarrisLinkedListMapOrcGC {
+
+private:
+    struct ValNode : public orc_base {
+        V val;
+        ValNode(V val) : val{val} { }
+    };
+
+    struct alignas(Layout::nodeAlign) Node : public orc_base {
+        K key;
+        orc_atomic<ValNode*> val;
+        orc_atomic<Node*> next;
+
+        Node(K key, ValNode* val) : key{key}, val{val}, next{nullptr} { }
+        void poisonAllLinks() { next.poison(); }
+    };
+
+    // Pointers to head and tail sentinel nodes of the list
+    orc_atomic<Node*> head;
+    orc_atomic<Node*> tail;
+
+public:
+
+    MichaelHarrisLinkedListMapOrcGC() {
+        head = make_orc<Node>(K{}, nullptr);
+        tail = make_orc<Node>(K{}, nullptr);
+        head->next = tail;
+    }
+
+
+    // We don't expect the destructor to be called if this instance can still be in use
+    ~MichaelHarrisLinkedListMapOrcGC() {
+        head = nullptr;
+    }
+
+    static std::string className() { return "MichaelHarris-LinkedListMap-OrcGC" + Layout::suffix(); }
+
+    // Size in bytes of each entry, including padding
+    static size_t nodeSize() { return sizeof(Node) + sizeof(ValNode); }
+
+
+    /**
+     * Returns the value associated with 'key', if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> get(K key) {
+        orc_ptr<Node*> prev, curr, next;
+        if (!find(&key, prev, curr, next)) return {};
+        orc_ptr<ValNode*> lval = curr->val.load();
+        if (lval == nullptr) return {};
+        return lval->val;
+    }
+
+
+    /**
+     * Associates 'val' with 'key' and returns the previous value, if any.
+     * If 'key' is already in the list, only its value is swapped.
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> put(K key, V val) {
+        orc_ptr<ValNode*> newVal = make_orc<ValNode>(val);
+        orc_ptr<Node*> newNode;
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (find(&key, prev, curr, next)) {
+                orc_ptr<ValNode*> lval = curr->val.load();
+                if (lval == nullptr) {
+                    // Being removed. Help it to get out of the way and try again
+                    markNext(curr);
+                    continue;
+                }
+                if (curr->val.compare_exchange_strong(lval, newVal)) return lval->val;
+                continue;
+            }
+            if (newNode == nullptr) newNode = make_orc<Node>(key, newVal);
+            newNode->next.store(curr, std::memory_order_relaxed);
+            Node *tmp = curr;
+            if (prev->next.compare_exchange_strong(tmp, newNode)) return {};
+        }
+    }
+
+
+    /**
+     * Associates 'val' with 'key' only if there is no value for 'key'.
+     * Returns the current value if there is one, or an empty optional if 'val' was inserted.
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> putIfAbsent(K key, V val) {
+        orc_ptr<Node*> newNode;
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (find(&key, prev, curr, next)) {
+                orc_ptr<ValNode*> lval = curr->val.load();
+                if (lval != nullptr) return lval->val;
+                markNext(curr);
+                continue;
+            }
+            if (newNode == nullptr) newNode = make_orc<Node>(key, make_orc<ValNode>(val));
+            newNode->next.store(curr, std::memory_order_relaxed);
+            Node *tmp = curr;
+            if (prev->next.compare_exchange_strong(tmp, newNode)) return {};
+        }
+    }
+
+
+    // Same as putIfAbsent() but returns true if the new entry was inserted
+    bool insert(K key, V val) {
+        return !putIfAbsent(key, val).has_value();
+    }
+
+
+    /**
+     * Replaces the value of 'key' only if there is one, and returns the previous value
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> replace(K key, V val) {
+        orc_ptr<ValNode*> newVal = make_orc<ValNode>(val);
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (!find(&key, prev, curr, next)) return {};
+            orc_ptr<ValNode*> lval = curr->val.load();
+            if (lval == nullptr) return {};
+            if (curr->val.compare_exchange_strong(lval, newVal)) return lval->val;
+        }
+    }
+
+
+    /**
+     * Removes 'key' and returns its value, if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> innerRemove(K key) {
+        orc_ptr<Node*> prev, curr, next;
+        while (true) {
+            if (!find(&key, prev, curr, next)) return {};
+            orc_ptr<ValNode*> lval = curr->val.load();
+            if (lval == nullptr) return {};
+            if (!curr->val.compare_exchange_strong(lval, nullptr)) continue;
+            // Logically removed. Now mark and unlink it
+            markNext(curr);
+            find(&key, prev, curr, next);
+            return lval->val;
+        }
+    }
+
+
+    // Wrappers for the "set" benchmarks
+    bool add(K key) { return insert(key, key); }
+
+    bool remove(K key) { return innerRemove(key).has_value(); }
+
+    bool contains(K key) { return get(key).has_value(); }
+
+    void addAll(K** keys, const int size) {
+        for (int i = 0; i < size; i++) add(*keys[i]);
+    }
+
+
+private:
+
+    // Marks the next of 'node' so that it is unlinked by find()
+    void markNext(orc_ptr<Node*>& node) {
+        while (true) {
+            orc_ptr<Node*> lnext = node->next.load();
+            if (isMarked(lnext)) return;
+            if (node->next.compare_exchange_strong(lnext, getMarked(lnext))) return;
+        }
+    }
+
+    /**
+     * Same as find() in MichaelHarrisLinkedListSetOrcGC
+     * Progress Condition: Lock-Free
+     */
+    bool find (K* key, orc_ptr<Node*>& prev, orc_ptr<Node*>& curr, orc_ptr<Node*>& next) {
+     try_again:
+        prev = head.load();
+        curr = prev->next.load();
+        while (true) {
+            if (curr == tail) return false;
+            next = curr->next.load();
+            Node* un_next = getUnmarked(next);
+            if (un_next == next) { // !cmark in the paper
+                if (!(curr->key < *key)) {
+                    return (curr->key == *key);
+                }
+                prev = curr;
+            } else {
+                // Update the link and retire the node.
+                Node *tmp = curr;
+                if (!prev->next.compare_exchange_strong(tmp, un_next)) {
+                    if (prev->next.load() != un_next) goto try_again;
+                }
+            }
+            curr.setUnmarked(next);
+        }
+    }
+
+    bool isMarked(Node * node) {
+        return ((size_t) node & 0x1ULL);
+    }
+
+    Node * getMarked(Node * node) {
+        return (Node*)((size_t) node | 0x1ULL);
+    }
+
+    Node * getUnmarked(Node * node) {
+        return (Node*)((size_t) node & (~0x1ULL));
+    }
+};
@@ -77,6 +77,9 @@ public:
 
     static std::string className() { return "MichaelHarris-LinkedListSet-" + Reclaimer<Node>::className(); }
 
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
+
     void addAll(T** keys, const int size) {
         for(int i=0;i<size;i++){
             T* key = keys[i];
@@ -14,6 +14,8 @@
 #include <string>
 
 #include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+#include "../../common/BulkLoad.hpp"
 
 using namespace orcgc_ptp;
 
@@ -31,21 +33,21 @@ using namespace orcgc_ptp;
  * <ul>
  * <li>add(x)      - Lock-Free
  * <li>remove(x)   - Lock-Free
- * <li>contains(x) - Lock-Free
+ * <li>contains(x) - Wait-Free (bounded by key space)
  * </ul><p>
  * <p>
  */
-template<typename T>
+template<typename T, typename Layout = PaddedLayout>
 class MichaelHarrisLinkedListSetOrcGC {
 
 private:
-    struct Node : public orc_base {
+    struct alignas(Layout::nodeAlign) Node : public orc_base {
         T key;
         orc_atomic<Node*> next;
 
         Node(T key) : key{key}, next{nullptr} { }
         void poisonAllLinks() { next.poison(); }
-    } __attribute__((aligned(128)));
+    };
 
     // Pointers to head and tail sentinel nodes of the list
     orc_atomic<Node*> head;
@@ -65,12 +67,22 @@ public:
         head = nullptr;
     }
 
-    static std::string className() { return "MichaelHarris-LinkedListSet-OrcGC"; }
+    static std::string className() { return "MichaelHarris-LinkedListSet-OrcGC" + Layout::suffix(); }
 
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
+
+    /**
+     * If the list is empty, the keys are sorted and linked in a new chain which is then
+     * published with a single CAS (see BulkLoad.hpp). Otherwise, calls add() for each key.
+     * Not lock-free
+     */
     void addAll(T** keys, const int size) {
-        for(int i=0;i<size;i++){
-            T* key = keys[i];
-            add(*key);
+        if (!bulkLoad(keys, size)) {
+            for(int i=0;i<size;i++){
+                T* key = keys[i];
+                add(*key);
+            }
         }
     }
 
@@ -118,21 +130,49 @@ public:
 
 
     /**
-     * This is named 'Search()' on the original paper
-     * Taken from Figure 7 of the paper:
-     * "High Performance Dynamic Lock-Free Hash Tables and List-Based Sets"
+     * This is named 'Search()' on the original paper, but unlike find() it doesn't unlink the
+     * marked nodes, it goes through them like the contains() of HerlihyShavitHarrisLinkedListSetOrcGC.
+     * An unlinked node is kept alive by OrcGC while we hold it and its next still leads to larger
+     * keys, therefore this never writes to shared memory and never restarts.
+     * It uses two hazardous pointers, one for 'curr' and one for 'next'.
      * <p>
-     * Progress Condition: Lock-Free
+     * Progress Condition: Wait-Free (bounded by the key space)
      */
     bool contains(T key) {
-        orc_ptr<Node*> prev, curr, next;
-        bool ret = find(&key, prev, curr, next);
-        return ret;
+        orc_ptr<Node*> curr = head.load();
+        orc_ptr<Node*> next = curr->next.load();
+        curr.setUnmarked(next);
+        while (curr != tail) {
+            next = curr->next.load();
+            if (!(curr->key < key)) return (curr->key == key && !isMarked(next));
+            curr.setUnmarked(next);
+        }
+        return false;
     }
 
 
 private:
 
+    // Returns false if the list was not empty and nothing was done
+    bool bulkLoad(T** keys, const int size) {
+        orc_ptr<Node*> ltail = tail.load();
+        if (head->next.load() != ltail) return false;
+        if (size == 0) return true;
+        std::vector<T*> sorted = bulkSortedUnique(keys, size);
+        const int n = (int)sorted.size();
+        std::vector<Node*> nodes(n);
+        // The first node is the only one without a predecessor in the chain
+        orc_ptr<Node*> first = make_orc<Node>(*sorted[0]);
+        nodes[0] = first;
+        for (int i = 1; i < n; i++) nodes[i] = make_orc_unpublished<Node>(1, *sorted[i]);
+        bulkParallelFor(n-1, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) nodes[i]->next.init(nodes[i+1]);
+        });
+        nodes[n-1]->next.store(ltail);
+        return head->next.compare_exchange_strong(ltail, first);
+    }
+
+
     /**
      * Progress Condition: Lock-Free
      */
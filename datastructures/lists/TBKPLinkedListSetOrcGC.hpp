@@ -16,6 +16,7 @@
 #include <string>
 
 #include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
 
 using namespace orcgc_ptp;
 
@@ -41,7 +42,7 @@ using namespace orcgc_ptp;
  * </ul><p>
  * <p>
  */
-template<typename T>
+template<typename T, typename Layout = PaddedLayout>
 class TBKPLinkedListSetOrcGC {
 
 private:
@@ -52,13 +53,13 @@ private:
     struct Node;
 
     // L229-L236, Appendix B
-    struct ReferenceBooleanTriplet : public orc_base {
+    struct alignas(Layout::nodeAlign) ReferenceBooleanTriplet : public orc_base {
         orc_atomic<Node*> reference;
         const bool        bit;
         const uint64_t    version;
         ReferenceBooleanTriplet(Node* r, bool i, uint64_t v) : reference{r}, bit{i}, version{v} {}
         void poisonAllLinks() { reference.poison(); }
-    } __attribute__((aligned(128)));
+    };
 
     // L240-L242
     struct VersionedAtomicMarkableReference : public orc_base {
@@ -131,21 +132,21 @@ private:
         void poisonAllLinks() { atomicRef.poison(); }
     };
 
-    struct Node : public orc_base {
+    struct alignas(Layout::nodeAlign) Node : public orc_base {
         T key;
         VersionedAtomicMarkableReference next{nullptr, false};
         std::atomic<bool> d {false};
 
         Node(T key) : key{key} { }
         void poisonAllLinks() { next.poisonAllLinks(); }
-    } __attribute__((aligned(128)));
+    };
 
-    struct Window : public orc_base {
+    struct alignas(Layout::nodeAlign) Window : public orc_base {
         orc_atomic<Node*> pred;
         orc_atomic<Node*> curr;
         Window(orc_ptr<Node*>& p, orc_ptr<Node*>& c) : pred{p}, curr{c} {}
         void poisonAllLinks() { pred.poison(); curr.poison(); }
-    } __attribute__((aligned(128)));
+    };
 
     struct OpDesc : public orc_base {
         uint64_t            phase;
@@ -180,7 +181,10 @@ public:
         head = nullptr;
     }
 
-    static std::string className() { return "TBKP-LinkedListSet-OrcGC" ; }
+    static std::string className() { return "TBKP-LinkedListSet-OrcGC" + Layout::suffix(); }
+
+    // Size in bytes of each node, including padding. Each node also has one ReferenceBooleanTriplet
+    static size_t nodeSize() { return sizeof(Node) + sizeof(ReferenceBooleanTriplet); }
 
     void addAll(T** keys, const int size) {
         for(int i=0;i<size;i++){
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+#include "../../trackers/OrcPTP.hpp"
+#include "common/ThreadRegistry.hpp"
+
+using namespace orcgc_ptp;
+
+
+/**
+ * <h1> Ring pool for the LCRQ queues </h1>
+ *
+ * Used by LCRQueueOrcGC and LCRQueuePortableOrcGC (see LCRQueueBaseOrcGC.hpp). Instead of freeing a
+ * ring when OrcGC finds it unreachable, recycle() resets it and keeps it in the pool, up to
+ * MAX_POOLED_RINGS, so that bursts of closed rings don't turn into large malloc()/free() pairs.
+ * The queue holds one reference to the pool and each ring that is not in the pool holds another,
+ * therefore the pool outlives the queue for as long as there are rings that point to it.
+ *
+ * 'Ring' must extend orc_base, have a constructor Ring(LCRQRingPool*) that sets its _deleter to
+ * recycle(), and keep the pool in a member named 'pool'.
+ */
+template<typename Ring, int MAX_POOLED_RINGS>
+struct LCRQRingPool {
+    std::atomic<Ring*>   rings[MAX_POOLED_RINGS > 0 ? MAX_POOLED_RINGS : 1];
+    std::atomic<int64_t> refs {1};              // One for the queue plus one for each ring that is not in rings[]
+    std::atomic<int>     pooled {0};            // Rings in rings[], plus the ones that recycle() has reserved a slot for
+
+    LCRQRingPool() {
+        for (int i = 0; i < MAX_POOLED_RINGS; i++) rings[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~LCRQRingPool() {
+        for (int i = 0; i < MAX_POOLED_RINGS; i++) {
+            Ring* ring = rings[i].load();
+            if (ring != nullptr) freeRing(ring);
+        }
+    }
+
+    Ring* get() {
+        for (int i = 0; i < MAX_POOLED_RINGS; i++) {
+            if (rings[i].load(std::memory_order_relaxed) == nullptr) continue;
+            Ring* ring = rings[i].exchange(nullptr);
+            if (ring != nullptr) {
+                pooled.fetch_sub(1);
+                return ring;
+            }
+        }
+        return nullptr;
+    }
+
+    // Returns true if there is room for one more ring in the pool, and keeps it for the next put()
+    bool reserve() {
+        int n = pooled.load();
+        while (n < MAX_POOLED_RINGS) {
+            if (pooled.compare_exchange_weak(n, n+1)) return true;
+        }
+        return false;
+    }
+
+    // Must be called after a successful reserve(), which guarantees that there is an empty slot
+    void put(Ring* ring) {
+        while (true) {
+            for (int i = 0; i < MAX_POOLED_RINGS; i++) {
+                Ring* empty = nullptr;
+                if (rings[i].load(std::memory_order_relaxed) == nullptr && rings[i].compare_exchange_strong(empty, ring)) return;
+            }
+        }
+    }
+
+    void release() {
+        if (refs.fetch_sub(1) == 1) delete this;
+    }
+
+    // Returns a new ring, taken from the pool if possible
+    orc_ptr<Ring*> allocRing() {
+        Ring* ring = get();
+        if (ring == nullptr) {
+            ring = new Ring(this);
+            if (OrcLiveObjects::enabled) g_orc_live.countAllocated(g_orc_live.typeIndex<Ring>(), ThreadRegistry::getTID());
+        }
+        refs.fetch_add(1);
+        return orc_adopt(ring);
+    }
+
+    static void freeRing(Ring* ring) {
+        delete ring;
+        if (OrcLiveObjects::enabled) g_orc_live.countDeleted(g_orc_live.typeIndex<Ring>(), ThreadRegistry::getTID());
+    }
+
+    // Called by OrcGC when the ring is unreachable. If there is room for it in the pool, runs the
+    // destructor, like 'delete' would, and puts a freshly constructed ring in the pool. Otherwise frees it
+    static void recycle(void* obj) {
+        Ring* ring = static_cast<Ring*>(obj);
+        LCRQRingPool* pool = ring->pool;
+        if (pool->reserve()) {
+            ring->~Ring();
+            new (ring) Ring(pool);
+            pool->put(ring);
+        } else {
+            freeRing(ring);
+        }
+        pool->release();
+    }
+};
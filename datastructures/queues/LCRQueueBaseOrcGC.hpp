@@ -0,0 +1,297 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <string>
+
+#include "../../trackers/OrcPTP.hpp"
+#include "common/ThreadRegistry.hpp"
+#include "LCRQRingPool.hpp"
+
+using namespace orcgc_ptp;
+
+
+/**
+ * <h1> LCRQ Queue (common part) </h1>
+ *
+ * This is LCRQ by Adam Morrison and Yehuda Afek
+ * http://www.cs.tau.ac.il/~mad/publications/ppopp2013-x86queues.pdf
+ *
+ * The list of rings, the tickets of each ring, closing and fixing the state of a ring, and the batches
+ * are the same in LCRQueueOrcGC and LCRQueuePortableOrcGC. What is different is how a cell holds its
+ * item, index and unsafe bit, which is given by the 'Cells' policy:
+ *   Cell                                  The type of the cells, 128 bytes each
+ *   MAX_TICKETS                           Tickets at or beyond this one can not be used and close the ring
+ *   className()                           Name of the queue for the default RING_POW
+ *   checkItem(item)                       Called on each item before it is enqueued
+ *   reset(cell, i)                        Makes cell 'i' of a new (or recycled) ring empty
+ *   storeSolo(cell, i, item)              Puts 'item' in cell 'i' of a ring that is not yet published
+ *   enqueueTicket(cell, ticket, item, head)   Enqueue protocol on a cell, returns true on success
+ *   dequeueTicket(cell, ticket, tail)         Dequeue protocol on a cell, returns the item or nullptr
+ *   closeRing(tail)                       Sets the closed bit on the tail of a ring, like BIT_TEST_AND_SET
+ *
+ * enqueueBatch() takes a contiguous range of tickets with a single fetch_add() on the tail of the ring, for as
+ * many free cells as there seem to be, and dequeueBatch() does the same on the head, for as many items as
+ * there seem to be in the ring.
+ *
+ * Each ring has 2^RING_POW cells of 128 bytes, which is 128KB for the default RING_POW of 10.
+ * Instead of freeing a ring when OrcGC finds it unreachable, its _deleter resets it and keeps it in the
+ * queue's pool, up to MAX_POOLED_RINGS, so that bursts of closed rings don't turn into large
+ * malloc()/free() pairs (see LCRQRingPool.hpp).
+ *
+ * <p>
+ * enqueue algorithm: MS enqueue + LCRQ with re-usage
+ * dequeue algorithm: MS dequeue + LCRQ with re-usage
+ * Consistency: Linearizable
+ * enqueue() progress: lock-free
+ * dequeue() progress: lock-free
+ * Memory Reclamation: OrcGC
+ */
+template<typename T, int RING_POW, typename Cells>
+class LCRQueueBaseOrcGC {
+
+private:
+    static const uint64_t RING_SIZE = 1ull << RING_POW;
+    static const int MAX_POOLED_RINGS = 4;          // Set to zero to free every unreachable ring
+    static const uint64_t CLOSED_BIT = 1ull << 63;
+
+    struct Node;
+
+    using RingPool = LCRQRingPool<Node, MAX_POOLED_RINGS>;
+    using Cell = typename Cells::Cell;
+
+    struct Node : orc_base {
+        std::atomic<int64_t> head  __attribute__ ((aligned (128)));
+        std::atomic<int64_t> tail  __attribute__ ((aligned (128)));
+        orc_atomic<Node*>    next  __attribute__ ((aligned (128)));
+        Cell array[RING_SIZE];
+        RingPool*            pool;
+
+        Node(RingPool* pool) : pool{pool} {
+            this->_deleter = &RingPool::recycle;
+            for (unsigned i = 0; i < RING_SIZE; i++) Cells::reset(array[i], i);
+            head.store(0, std::memory_order_relaxed);
+            tail.store(0, std::memory_order_relaxed);
+            next.store(nullptr, std::memory_order_relaxed);
+        }
+        void poisonAllLinks() { next.poison(); }
+    } __attribute__((aligned(128)));
+
+    alignas(128) orc_atomic<Node*> head;
+    alignas(128) orc_atomic<Node*> tail;
+    RingPool*                      pool;
+
+
+    /*
+     * Private methods
+     */
+    static inline uint64_t tail_index(uint64_t t) {
+        return (t & ~CLOSED_BIT);
+    }
+
+    static inline int crq_is_closed(uint64_t t) {
+        return (t & CLOSED_BIT) != 0;
+    }
+
+    void fixState(orc_ptr<Node*>& lhead) {
+        while (1) {
+            uint64_t t = lhead->tail.fetch_add(0);
+            uint64_t h = lhead->head.fetch_add(0);
+            // TODO: is it ok or not to cast "t" to int64_t ?
+            if (lhead->tail.load() != (int64_t)t) continue;
+            if (h > t) {
+                int64_t tmp = t;
+                if (lhead->tail.compare_exchange_strong(tmp, h)) break;
+                continue;
+            }
+            break;
+        }
+    }
+
+    int close_crq(orc_ptr<Node*>& rq, const uint64_t tailticket, const int tries) {
+        if (tries < 10) {
+            int64_t tmp = tailticket + 1;
+            return rq->tail.compare_exchange_strong(tmp, (tailticket + 1)|CLOSED_BIT);
+        }
+        else {
+            return Cells::closeRing(rq->tail);
+        }
+    }
+
+    // Tries to put 'item' in the cell of 'tailticket'. Returns true on success
+    bool enqueueTicket(orc_ptr<Node*>& ltail, const uint64_t tailticket, T* item) {
+        return Cells::enqueueTicket(ltail->array[tailticket & (RING_SIZE-1)], tailticket, item, ltail->head);
+    }
+
+    // Runs the dequeue protocol on the cell of 'headticket'. Returns the item, or nullptr if there was none
+    T* dequeueTicket(orc_ptr<Node*>& lhead, const uint64_t headticket) {
+        if (headticket >= Cells::MAX_TICKETS) {
+            // No enqueuer can use this ticket, which means the ring is done
+            Cells::closeRing(lhead->tail);
+            return nullptr;
+        }
+        return Cells::dequeueTicket(lhead->array[headticket & (RING_SIZE-1)], headticket, lhead->tail);
+    }
+
+
+public:
+    LCRQueueBaseOrcGC() {
+        // Shared object init
+        pool = new RingPool();
+        orc_ptr<Node*> sentinel = pool->allocRing();
+        head.store(sentinel, std::memory_order_relaxed);
+        tail.store(sentinel, std::memory_order_relaxed);
+    }
+
+
+    ~LCRQueueBaseOrcGC() {
+        while (dequeue() != nullptr); // Drain the queue
+        head.store(nullptr);
+        pool->release();
+    }
+
+    static std::string className() { return (RING_POW == 10) ? Cells::className() : Cells::className() + "-Ring" + std::to_string(RING_POW); }
+
+
+    void enqueue(T* item) {
+        Cells::checkItem(item);
+        int try_close = 0;
+        while (true) {
+            orc_ptr<Node*> ltail = tail.load();
+            orc_ptr<Node*> lnext = ltail->next.load();
+            if (lnext != nullptr) {  // Help advance the tail
+                tail.compare_exchange_strong(ltail, lnext);
+                continue;
+            }
+
+            uint64_t tailticket = ltail->tail.fetch_add(1);
+            if (crq_is_closed(tailticket)) {
+                orc_ptr<Node*> newNode = pool->allocRing();
+                // Solo enqueue (superfluous?)
+                newNode->tail.store(1, std::memory_order_relaxed);
+                Cells::storeSolo(newNode->array[0], 0, item);
+                Node* nullnode = nullptr;
+                if (ltail->next.compare_exchange_strong(nullnode, newNode)) {// Insert new ring
+                    tail.compare_exchange_strong(ltail, newNode); // Advance the tail
+                    return;
+                }
+                continue;
+            }
+            if (tailticket >= Cells::MAX_TICKETS) {  // Out of tickets
+                Cells::closeRing(ltail->tail);
+                continue;
+            }
+            if (enqueueTicket(ltail, tailticket, item)) return;
+            if (((int64_t)(tailticket - ltail->head.load()) >= (int64_t)RING_SIZE) && close_crq(ltail, tailticket, ++try_close)) continue;
+        }
+    }
+
+
+    T* dequeue() {
+        while (true) {
+            orc_ptr<Node*> lhead = head.load();
+            uint64_t headticket = lhead->head.fetch_add(1);
+            T* val = dequeueTicket(lhead, headticket);
+            if (val != nullptr) return val;
+            if (tail_index(lhead->tail.load()) <= headticket + 1) {
+                fixState(lhead);
+                // try to return empty
+                orc_ptr<Node*> lnext = lhead->next.load();
+                if (lnext == nullptr) return nullptr;  // Queue is empty
+                if (tail_index(lhead->tail) <= headticket + 1) {
+                    if (head.compare_exchange_strong(lhead, lnext)) {
+                        lhead->next.poison(); // Poison if enabled
+                    }
+                }
+            }
+        }
+    }
+
+
+    // Enqueues items[0] to items[n-1], in this order, taking in each fetch_add() as many tickets as there seem to be free cells
+    void enqueueBatch(T** items, const int n) {
+        for (int i = 0; i < n; i++) Cells::checkItem(items[i]);
+        int i = 0;
+        int try_close = 0;
+        while (i < n) {
+            orc_ptr<Node*> ltail = tail.load();
+            orc_ptr<Node*> lnext = ltail->next.load();
+            if (lnext != nullptr) {  // Help advance the tail
+                tail.compare_exchange_strong(ltail, lnext);
+                continue;
+            }
+
+            // Take at most the free cells seen in this ring, but at least one, so that a full ring is closed like in enqueue()
+            const int64_t freeCells = ltail->head.load() + (int64_t)RING_SIZE - (int64_t)tail_index(ltail->tail.load());
+            const uint64_t numTickets = std::max<int64_t>(1, std::min<int64_t>({(int64_t)(n - i), freeCells, (int64_t)RING_SIZE}));
+            uint64_t firstticket = ltail->tail.fetch_add(numTickets);
+            if (crq_is_closed(firstticket)) {
+                // Solo enqueue of as many items as fit in a new ring
+                const uint64_t numSolo = std::min<uint64_t>(n - i, RING_SIZE);
+                orc_ptr<Node*> newNode = pool->allocRing();
+                for (uint64_t j = 0; j < numSolo; j++) Cells::storeSolo(newNode->array[j], j, items[i+j]);
+                newNode->tail.store(numSolo, std::memory_order_relaxed);
+                Node* nullnode = nullptr;
+                if (ltail->next.compare_exchange_strong(nullnode, newNode)) {// Insert new ring
+                    tail.compare_exchange_strong(ltail, newNode); // Advance the tail
+                    i += numSolo;
+                }
+                continue;
+            }
+            // Each item goes into the first of the remaining tickets whose cell can take it, which keeps them in order
+            bool full = false;
+            for (uint64_t tailticket = firstticket; tailticket < firstticket + numTickets && i < n; tailticket++) {
+                if (tailticket >= Cells::MAX_TICKETS) {  // Out of tickets
+                    Cells::closeRing(ltail->tail);
+                    break;
+                }
+                if (enqueueTicket(ltail, tailticket, items[i])) {
+                    i++;
+                    continue;
+                }
+                if ((int64_t)(tailticket - ltail->head.load()) >= (int64_t)RING_SIZE) {
+                    full = true;
+                    break;
+                }
+            }
+            // The tickets we did not use are left for the dequeuers to skip, once the ring is closed
+            if (full) close_crq(ltail, firstticket + numTickets - 1, ++try_close);
+        }
+    }
+
+
+    // Dequeues up to 'max' items into out[], in FIFO order, and returns how many. Returns zero if the queue is empty
+    int dequeueBatch(T** out, const int max) {
+        int count = 0;
+        while (count < max) {
+            orc_ptr<Node*> lhead = head.load();
+            // Take as many tickets as there seem to be items in this ring, but at least one
+            const int64_t items = (int64_t)tail_index(lhead->tail.load()) - lhead->head.load();
+            const uint64_t numTickets = std::max<int64_t>(1, std::min<int64_t>({(int64_t)(max - count), items, (int64_t)RING_SIZE}));
+            uint64_t firstticket = lhead->head.fetch_add(numTickets);
+            for (uint64_t headticket = firstticket; headticket < firstticket + numTickets; headticket++) {
+                T* val = dequeueTicket(lhead, headticket);
+                if (val != nullptr) out[count++] = val;
+            }
+            const uint64_t lastticket = firstticket + numTickets - 1;
+            if (tail_index(lhead->tail.load()) <= lastticket + 1) {
+                fixState(lhead);
+                orc_ptr<Node*> lnext = lhead->next.load();
+                if (lnext == nullptr) return count;  // Queue is empty
+                if (tail_index(lhead->tail) <= lastticket + 1) {
+                    if (head.compare_exchange_strong(lhead, lnext)) {
+                        lhead->next.poison(); // Poison if enabled
+                    }
+                }
+            }
+        }
+        return count;
+    }
+};
@@ -8,11 +8,10 @@
  */
 #pragma once
 #include <atomic>
+#include <algorithm>
+#include <string>
 
-#include "../../trackers/OrcPTP.hpp"
-#include "common/ThreadRegistry.hpp"
-
-using namespace orcgc_ptp;
+#include "LCRQueueBaseOrcGC.hpp"
 
 
 // CAS2 macro
@@ -44,32 +43,11 @@ using namespace orcgc_ptp;
 
 
 
-/**
- * <h1> LCRQ Queue </h1>
- *
- * This is LCRQ by Adam Morrison and Yehuda Afek
- * http://www.cs.tau.ac.il/~mad/publications/ppopp2013-x86queues.pdf
- *
- * This implementation does NOT obey the C++ memory model rules AND it is x86 specific.
- * No guarantees are given on the correctness or consistency of the results if you use this queue.
- *
- * Bugs fixed:
- * tt was not initialized in dequeue();
- *
- * <p>
- * enqueue algorithm: MS enqueue + LCRQ with re-usage
- * dequeue algorithm: MS dequeue + LCRQ with re-usage
- * Consistency: Linearizable
- * enqueue() progress: lock-free
- * dequeue() progress: lock-free
- * Memory Reclamation: OrcGC
- */
-template<typename T>
-class LCRQueueOrcGC {
-
-private:
-    static const int RING_POW = 10;
+// Cells of LCRQueueOrcGC (see the 'Cells' policy in LCRQueueBaseOrcGC.hpp)
+template<typename T, int RING_POW>
+struct LCRQCellsCAS2 {
     static const uint64_t RING_SIZE = 1ull << RING_POW;
+    static const uint64_t MAX_TICKETS = 1ull << 63;  // No limit
 
     struct Cell {
         std::atomic<T*>       val;
@@ -77,190 +55,121 @@ private:
         uint64_t pad[14];
     } __attribute__ ((aligned (128)));
 
-    struct Node : orc_base {
-        std::atomic<int64_t> head  __attribute__ ((aligned (128)));
-        std::atomic<int64_t> tail  __attribute__ ((aligned (128)));
-        orc_atomic<Node*>    next  __attribute__ ((aligned (128)));
-        Cell array[RING_SIZE];
-
-        Node() {
-            for (unsigned i = 0; i < RING_SIZE; i++) {
-                array[i].val.store(nullptr, std::memory_order_relaxed);
-                array[i].idx.store(i, std::memory_order_relaxed);
-            }
-            head.store(0, std::memory_order_relaxed);
-            tail.store(0, std::memory_order_relaxed);
-            next.store(nullptr, std::memory_order_relaxed);
-        }
-        void poisonAllLinks() { next.poison(); }
-    } __attribute__((aligned(128)));
-
-    alignas(128) orc_atomic<Node*> head;
-    alignas(128) orc_atomic<Node*> tail;
-
-
-    /*
-     * Private methods
-     */
-    int is_empty(T* v)  {
-        return (v == nullptr);
-    }
-
-    uint64_t node_index(uint64_t i) {
+    static uint64_t node_index(uint64_t i) {
         return (i & ~(1ull << 63));
     }
 
-    uint64_t set_unsafe(uint64_t i) {
+    static uint64_t set_unsafe(uint64_t i) {
         return (i | (1ull << 63));
     }
 
-    uint64_t node_unsafe(uint64_t i) {
+    static uint64_t node_unsafe(uint64_t i) {
         return (i & (1ull << 63));
     }
 
-    inline uint64_t tail_index(uint64_t t) {
+    static inline uint64_t tail_index(uint64_t t) {
         return (t & ~(1ull << 63));
     }
 
-    int crq_is_closed(uint64_t t) {
+    static int crq_is_closed(uint64_t t) {
         return (t & (1ull << 63)) != 0;
     }
 
-    void fixState(orc_ptr<Node*>& lhead) {
-        while (1) {
-            uint64_t t = lhead->tail.fetch_add(0);
-            uint64_t h = lhead->head.fetch_add(0);
-            // TODO: is it ok or not to cast "t" to int64_t ?
-            if (lhead->tail.load() != (int64_t)t) continue;
-            if (h > t) {
-                int64_t tmp = t;
-                if (lhead->tail.compare_exchange_strong(tmp, h)) break;
-                continue;
-            }
-            break;
-        }
-    }
-
-    int close_crq(orc_ptr<Node*>& rq, const uint64_t tailticket, const int tries) {
-        if (tries < 10) {
-            int64_t tmp = tailticket + 1;
-            return rq->tail.compare_exchange_strong(tmp, (tailticket + 1)|(1ull<<63));
-        }
-        else {
-            return BIT_TEST_AND_SET(&rq->tail, 63);
-        }
-    }
+    static std::string className() { return "LCRQueue-OrcGC"; }
 
+    static inline void checkItem(T*) { }
 
-public:
-    LCRQueueOrcGC() {
-        // Shared object init
-        orc_ptr<Node*> sentinel = make_orc<Node>();
-        head.store(sentinel, std::memory_order_relaxed);
-        tail.store(sentinel, std::memory_order_relaxed);
+    static void reset(Cell& cell, const uint64_t i) {
+        cell.val.store(nullptr, std::memory_order_relaxed);
+        cell.idx.store(i, std::memory_order_relaxed);
     }
 
-
-    ~LCRQueueOrcGC() {
-        while (dequeue() != nullptr); // Drain the queue
-        head.store(nullptr);
+    static void storeSolo(Cell& cell, const uint64_t i, T* item) {
+        cell.val.store(item, std::memory_order_relaxed);
+        cell.idx.store(i, std::memory_order_relaxed);
     }
 
-    static std::string className() { return "LCRQueue-OrcGC"; }
-
-
-    void enqueue(T* item) {
-        int try_close = 0;
-        while (true) {
-            orc_ptr<Node*> ltail = tail.load();
-            orc_ptr<Node*> lnext = ltail->next.load();
-            if (lnext != nullptr) {  // Help advance the tail
-                tail.compare_exchange_strong(ltail, lnext);
-                continue;
-            }
+    static inline bool closeRing(std::atomic<int64_t>& tail) {
+        return BIT_TEST_AND_SET(&tail, 63);
+    }
 
-            uint64_t tailticket = ltail->tail.fetch_add(1);
-            if (crq_is_closed(tailticket)) {
-                orc_ptr<Node*> newNode = make_orc<Node>();
-                // Solo enqueue (superfluous?)
-                newNode->tail.store(1, std::memory_order_relaxed);
-                newNode->array[0].val.store(item, std::memory_order_relaxed);
-                newNode->array[0].idx.store(0, std::memory_order_relaxed);
-                Node* nullnode = nullptr;
-                if (ltail->next.compare_exchange_strong(nullnode, newNode)) {// Insert new ring
-                    tail.compare_exchange_strong(ltail, newNode); // Advance the tail
-                    return;
+    static bool enqueueTicket(Cell& cell, const uint64_t tailticket, T* item, std::atomic<int64_t>& head) {
+        uint64_t idx = cell.idx.load();
+        if (cell.val.load() == nullptr) {
+            if (node_index(idx) <= tailticket) {
+                // TODO: is the missing cast before "t" ok or not to add?
+                if ((!node_unsafe(idx) || head.load() < (int64_t)tailticket)) {
+                    if (CAS2((void**)&cell, nullptr, idx, item, tailticket)) return true;
                 }
-                continue;
             }
-            Cell* cell = &ltail->array[tailticket & (RING_SIZE-1)];
-            uint64_t idx = cell->idx.load();
-            if (cell->val.load() == nullptr) {
-                if (node_index(idx) <= tailticket) {
-                    // TODO: is the missing cast before "t" ok or not to add?
-                    if ((!node_unsafe(idx) || ltail->head.load() < (int64_t)tailticket)) {
-                        if (CAS2((void**)cell, nullptr, idx, item, tailticket)) return;
-                    }
-                }
-            }
-            if (((int64_t)(tailticket - ltail->head.load()) >= (int64_t)RING_SIZE) && close_crq(ltail, tailticket, ++try_close)) continue;
         }
+        return false;
     }
 
+    static T* dequeueTicket(Cell& cell, const uint64_t headticket, std::atomic<int64_t>& tail) {
+        int r = 0;
+        uint64_t tt = 0;
 
-    T* dequeue() {
         while (true) {
-            orc_ptr<Node*> lhead = head.load();
-            uint64_t headticket = lhead->head.fetch_add(1);
-            Cell* cell = &lhead->array[headticket & (RING_SIZE-1)];
-
-            int r = 0;
-            uint64_t tt = 0;
+            uint64_t cell_idx = cell.idx.load();
+            uint64_t unsafe = node_unsafe(cell_idx);
+            uint64_t idx = node_index(cell_idx);
+            T* val = cell.val.load();
 
-            while (true) {
-                uint64_t cell_idx = cell->idx.load();
-                uint64_t unsafe = node_unsafe(cell_idx);
-                uint64_t idx = node_index(cell_idx);
-                T* val = cell->val.load();
+            if (idx > headticket) break;
 
-                if (idx > headticket) break;
-
-                if (val != nullptr) {
-                    if (idx == headticket) {
-                        if (CAS2((void**)cell, val, cell_idx, nullptr, unsafe | (headticket + RING_SIZE))) return val;
-                    } else {
-                        if (CAS2((void**)cell, val, cell_idx, val, set_unsafe(idx))) break;
-                    }
+            if (val != nullptr) {
+                if (idx == headticket) {
+                    if (CAS2((void**)&cell, val, cell_idx, nullptr, unsafe | (headticket + RING_SIZE))) return val;
                 } else {
-                    if ((r & ((1ull << 10) - 1)) == 0) tt = lhead->tail.load();
-                    // Optimization: try to bail quickly if queue is closed.
-                    int crq_closed = crq_is_closed(tt);
-                    uint64_t t = tail_index(tt);
-                    if (unsafe) { // Nothing to do, move along
-                        if (CAS2((void**)cell, val, cell_idx, val, unsafe | (headticket + RING_SIZE)))
-                            break;
-                    } else if (t < headticket + 1 || r > 200000 || crq_closed) {
-                        if (CAS2((void**)cell, val, idx, val, headticket + RING_SIZE)) {
-                            if (r > 200000 && tt > RING_SIZE) BIT_TEST_AND_SET(&lhead->tail, 63);
-                            break;
-                        }
-                    } else {
-                        ++r;
-                    }
+                    if (CAS2((void**)&cell, val, cell_idx, val, set_unsafe(idx))) break;
                 }
-            }
-
-            if (tail_index(lhead->tail.load()) <= headticket + 1) {
-                fixState(lhead);
-                // try to return empty
-                orc_ptr<Node*> lnext = lhead->next.load();
-                if (lnext == nullptr) return nullptr;  // Queue is empty
-                if (tail_index(lhead->tail) <= headticket + 1) {
-                    if (head.compare_exchange_strong(lhead, lnext)) {
-                        lhead->next.poison(); // Poison if enabled
+            } else {
+                if ((r & ((1ull << 10) - 1)) == 0) tt = tail.load();
+                // Optimization: try to bail quickly if queue is closed.
+                int crq_closed = crq_is_closed(tt);
+                uint64_t t = tail_index(tt);
+                if (unsafe) { // Nothing to do, move along
+                    if (CAS2((void**)&cell, val, cell_idx, val, unsafe | (headticket + RING_SIZE)))
+                        break;
+                } else if (t < headticket + 1 || r > 200000 || crq_closed) {
+                    if (CAS2((void**)&cell, val, idx, val, headticket + RING_SIZE)) {
+                        if (r > 200000 && tt > RING_SIZE) BIT_TEST_AND_SET(&tail, 63);
+                        break;
                     }
+                } else {
+                    ++r;
                 }
             }
         }
+        return nullptr;
     }
 };
+
+
+/**
+ * <h1> LCRQ Queue </h1>
+ *
+ * This is LCRQ by Adam Morrison and Yehuda Afek
+ * http://www.cs.tau.ac.il/~mad/publications/ppopp2013-x86queues.pdf
+ *
+ * This implementation does NOT obey the C++ memory model rules AND it is x86 specific.
+ * No guarantees are given on the correctness or consistency of the results if you use this queue.
+ *
+ * Bugs fixed:
+ * tt was not initialized in dequeue();
+ *
+ * Each cell has the item and the index (with the unsafe bit) of the original algorithm, side by side,
+ * and is updated with a double-width CAS. The rest of the queue, including the batches and the ring
+ * pool, is in LCRQueueBaseOrcGC.hpp and is shared with LCRQueuePortableOrcGC.
+ *
+ * <p>
+ * enqueue algorithm: MS enqueue + LCRQ with re-usage
+ * dequeue algorithm: MS dequeue + LCRQ with re-usage
+ * Consistency: Linearizable
+ * enqueue() progress: lock-free
+ * dequeue() progress: lock-free
+ * Memory Reclamation: OrcGC
+ */
+template<typename T, int RING_POW = 10>
+using LCRQueueOrcGC = LCRQueueBaseOrcGC<T, RING_POW, LCRQCellsCAS2<T, RING_POW>>;
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "LCRQueueBaseOrcGC.hpp"
+
+
+// Cells of LCRQueuePortableOrcGC (see the 'Cells' policy in LCRQueueBaseOrcGC.hpp)
+template<typename T, int RING_POW>
+struct LCRQCellsPortable {
+    static const uint64_t RING_SIZE = 1ull << RING_POW;
+    static const int      PTR_BITS = 48;
+    static const uint64_t PTR_MASK = (1ull << PTR_BITS) - 1;
+    static const uint64_t UNSAFE_BIT = 1ull << 63;
+    static const uint64_t CLOSED_BIT = 1ull << 63;
+    static const uint64_t MAX_CYCLE = (1ull << (63 - PTR_BITS)) - 1;
+    static const uint64_t MAX_TICKETS = MAX_CYCLE << RING_POW;  // The last cycle is only used by dequeue()
+
+    static_assert(sizeof(void*) == 8, "LCRQueuePortableOrcGC needs 64 bit pointers");
+
+    struct Cell {
+        std::atomic<uint64_t> word;
+        uint64_t pad[15];
+    } __attribute__ ((aligned (128)));
+
+    static inline uint64_t cell_pack(uint64_t unsafe, uint64_t cycle, T* val) {
+        return unsafe | (cycle << PTR_BITS) | (uint64_t)(uintptr_t)val;
+    }
+
+    static inline T* cell_val(uint64_t w) {
+        return (T*)(uintptr_t)(w & PTR_MASK);
+    }
+
+    static inline uint64_t cell_cycle(uint64_t w) {
+        return (w & ~UNSAFE_BIT) >> PTR_BITS;
+    }
+
+    static inline uint64_t cell_unsafe(uint64_t w) {
+        return (w & UNSAFE_BIT);
+    }
+
+    static inline uint64_t ticket_cycle(uint64_t ticket) {
+        return ticket >> RING_POW;
+    }
+
+    static inline uint64_t tail_index(uint64_t t) {
+        return (t & ~CLOSED_BIT);
+    }
+
+    static inline int crq_is_closed(uint64_t t) {
+        return (t & CLOSED_BIT) != 0;
+    }
+
+    static std::string className() { return "LCRQueuePortable-OrcGC"; }
+
+    static void checkItem(T* item) {
+        if (item == nullptr) throw std::invalid_argument("item can not be nullptr");
+        if (((uintptr_t)item >> PTR_BITS) != 0) throw std::invalid_argument("item address does not fit in 48 bits");
+    }
+
+    static void reset(Cell& cell, const uint64_t) {
+        cell.word.store(0, std::memory_order_relaxed);
+    }
+
+    static void storeSolo(Cell& cell, const uint64_t, T* item) {
+        cell.word.store(cell_pack(0, 0, item), std::memory_order_relaxed);
+    }
+
+    // Returns true if this call closed the ring
+    static inline bool closeRing(std::atomic<int64_t>& tail) {
+        return (tail.fetch_or(CLOSED_BIT) & CLOSED_BIT) == 0;
+    }
+
+    static bool enqueueTicket(Cell& cell, const uint64_t tailticket, T* item, std::atomic<int64_t>& head) {
+        uint64_t w = cell.word.load();
+        if (cell_val(w) == nullptr && cell_cycle(w) <= ticket_cycle(tailticket)) {
+            if ((!cell_unsafe(w) || head.load() < (int64_t)tailticket)) {
+                if (cell.word.compare_exchange_strong(w, cell_pack(0, ticket_cycle(tailticket), item))) return true;
+            }
+        }
+        return false;
+    }
+
+    static T* dequeueTicket(Cell& cell, const uint64_t headticket, std::atomic<int64_t>& tail) {
+        const uint64_t cycle = ticket_cycle(headticket);
+
+        int r = 0;
+        uint64_t tt = 0;
+
+        while (true) {
+            uint64_t w = cell.word.load();
+            uint64_t unsafe = cell_unsafe(w);
+            T* val = cell_val(w);
+
+            if (cell_cycle(w) > cycle) break;
+
+            if (val != nullptr) {
+                if (cell_cycle(w) == cycle) {
+                    if (cell.word.compare_exchange_strong(w, cell_pack(unsafe, cycle + 1, nullptr))) return val;
+                } else {
+                    if (cell.word.compare_exchange_strong(w, w | UNSAFE_BIT)) break;
+                }
+            } else {
+                if ((r & ((1ull << 10) - 1)) == 0) tt = tail.load();
+                // Optimization: try to bail quickly if queue is closed.
+                int crq_closed = crq_is_closed(tt);
+                uint64_t t = tail_index(tt);
+                if (unsafe) { // Nothing to do, move along
+                    if (cell.word.compare_exchange_strong(w, cell_pack(unsafe, cycle + 1, nullptr)))
+                        break;
+                } else if (t < headticket + 1 || r > 200000 || crq_closed) {
+                    if (cell.word.compare_exchange_strong(w, cell_pack(0, cycle + 1, nullptr))) {
+                        if (r > 200000 && tt > RING_SIZE) closeRing(tail);
+                        break;
+                    }
+                } else {
+                    ++r;
+                }
+            }
+        }
+        return nullptr;
+    }
+};
+
+
+/**
+ * <h1> LCRQ Queue (portable) </h1>
+ *
+ * This is LCRQ by Adam Morrison and Yehuda Afek
+ * http://www.cs.tau.ac.il/~mad/publications/ppopp2013-x86queues.pdf
+ *
+ * Same algorithm as LCRQueueOrcGC, but without the x86 inline assembly: it uses only std::atomic
+ * operations on 64 bit words and follows the C++ memory model, therefore it compiles with GCC and
+ * Clang on any 64 bit target and can be checked with ThreadSanitizer.
+ * Only the cells are different, the rest of the queue is in LCRQueueBaseOrcGC.hpp.
+ *
+ * Instead of a double-width CAS on the pair (val,idx), each cell is a single 64 bit word:
+ *   bit 63        unsafe bit
+ *   bits 48..62   cycle of the ticket that last used the cell, which is ticket >> RING_POW
+ *   bits 0..47    the item, nullptr when the cell is empty
+ * The position of the ticket in the ring is implicit in the cell, so comparing the cycles is the
+ * same as comparing the indexes of the original algorithm. The items must have addresses that fit
+ * in 48 bits, which is the case for user space on x86-64 and AArch64 Linux unless mmap() is asked
+ * for a higher address. enqueue() throws std::invalid_argument for other addresses.
+ * A cycle has 15 bits, so a ring can give out at most MAX_TICKETS tickets, which is 2^25 for the
+ * default RING_POW. Whoever gets a ticket beyond that closes the ring, like when it is full, and
+ * the queue moves on to a new ring (usually a recycled one, see LCRQRingPool.hpp).
+ * BIT_TEST_AND_SET is replaced with fetch_or() on the tail of the ring.
+ *
+ * <p>
+ * enqueue algorithm: MS enqueue + LCRQ with re-usage
+ * dequeue algorithm: MS dequeue + LCRQ with re-usage
+ * Consistency: Linearizable
+ * enqueue() progress: lock-free
+ * dequeue() progress: lock-free
+ * Memory Reclamation: OrcGC
+ */
+template<typename T, int RING_POW = 10>
+using LCRQueuePortableOrcGC = LCRQueueBaseOrcGC<T, RING_POW, LCRQCellsPortable<T, RING_POW>>;
@@ -10,6 +10,7 @@
 
 #include <atomic>
 #include <stdexcept>
+#include <string>
 
 #include "../../trackers/OrcPTP.hpp"
 
@@ -24,14 +25,33 @@ using namespace orcgc_ptp;
  * enqueue() progress: lock-free
  * dequeue() progress: lock-free
  * Memory Reclamation: OrcGC-HE
+ *
+ * enqueueBatch() links the new nodes among themselves before publishing them with a single CAS on the
+ * next of the last node, and dequeueBatch() takes up to 'max' nodes with a single CAS on head.
+ * Other threads only ever advance the tail one node at a time, therefore, after an enqueueBatch() the
+ * tail may be behind the last node for a while, and the dequeues help it forward before giving up.
+ *
+ * The queue can be given its own OrcGC domain with the 'domain' template parameter (see Domains in OrcPTP.hpp),
+ * otherwise it uses the global domain g_ptp.
+ *
+ * With SINGLE_PRODUCER, at most one thread at a time may call enqueue()/enqueueBatch(). That thread owns
+ * the next of the last node, which is always nullptr, so it links the new node with storeOwned(), a plain
+ * release store, instead of a CAS. The tail is still written with store(), which is an exchange(), because
+ * dequeuers may help it forward with a CAS. That is harmless because they can only move it to the node
+ * that the producer is about to store.
+ * With SINGLE_CONSUMER, at most one thread at a time may call dequeue()/dequeueBatch(). The head is
+ * changed only by that thread, which advances it with storeOwned() instead of a CAS.
+ * In both cases the links are still counted by OrcGC, with a fetch_add() on the counter of each node that
+ * is linked or unlinked, therefore the nodes and the items are as safe as in the MPMC queue.
+ * Breaking the single producer/consumer rule is undefined behavior.
  */
-template<typename T>
+template<typename T, bool SINGLE_PRODUCER = false, bool SINGLE_CONSUMER = false, PassThePointerOrcGC& domain = g_ptp>
 class MichaelScottQueueOrcGC {
 
 private:
     struct Node : orc_base {
         T* item;
-        orc_atomic<Node*> next {nullptr};
+        orc_atomic<Node*,domain> next {nullptr};
 
         Node(T* userItem) : item{userItem} { }
 
@@ -42,13 +62,13 @@ private:
     } __attribute__((aligned(128)));
 
     // Pointers to head and tail of the list
-    alignas(128) orc_atomic<Node*> head;
-    alignas(128) orc_atomic<Node*> tail;
+    alignas(128) orc_atomic<Node*,domain> head;
+    alignas(128) orc_atomic<Node*,domain> tail;
 
 
 public:
     MichaelScottQueueOrcGC() {
-        auto sentinelNode = make_orc<Node>(nullptr);
+        auto sentinelNode = make_orc<Node,domain>(nullptr);
         head.store(sentinelNode, std::memory_order_relaxed);
         tail.store(sentinelNode, std::memory_order_relaxed);
     }
@@ -59,15 +79,25 @@ public:
     }
 
 
-    static std::string className() { return "MichaelScottQueue-OrcGC"; }
+    static std::string className() {
+        const std::string suffix = (&domain != &g_ptp) ? "-Domain" : "";
+        if (!SINGLE_PRODUCER && !SINGLE_CONSUMER) return "MichaelScottQueue-OrcGC" + suffix;
+        return std::string("MichaelScottQueue-OrcGC-") + (SINGLE_PRODUCER ? "SP" : "MP") + (SINGLE_CONSUMER ? "SC" : "MC") + suffix;
+    }
 
 
     void enqueue(T* item) {
         if (item == nullptr) throw std::invalid_argument("item can not be nullptr");
-        orc_ptr<Node*> newNode = make_orc<Node>(item);
+        orc_ptr<Node*,domain> newNode = make_orc<Node,domain>(item);
+        if (SINGLE_PRODUCER) {
+            orc_ptr<Node*,domain> ltail = tail.load();
+            ltail->next.storeOwned(newNode, nullptr);
+            tail.store(newNode, std::memory_order_release);
+            return;
+        }
         while (true) {
-            orc_ptr<Node*> ltail = tail.load();              // orc_ptr
-            orc_ptr<Node*> lnext = ltail->next.load();       // orc_ptr
+            orc_ptr<Node*,domain> ltail = tail.load();              // orc_ptr
+            orc_ptr<Node*,domain> lnext = ltail->next.load();       // orc_ptr
             if (lnext == nullptr) {
                 // It seems this is the last node, so add the newNode here
                 // and try to move the tail to the newNode
@@ -83,16 +113,104 @@ public:
 
 
     T* dequeue() {
-        orc_ptr<Node*> node = head.load();                              // orc_ptr
-        while (node != tail.load().ptr) {
-            orc_ptr<Node*> lnext = node->next.load();                   // orc_ptr
+        orc_ptr<Node*,domain> node = head.load();                              // orc_ptr
+        while (true) {
+            if (node == tail.load().ptr) {
+                orc_ptr<Node*,domain> lnext = node->next.load();               // orc_ptr
+                if (lnext == nullptr) return nullptr;                   // Queue is empty
+                tail.compare_exchange_strong(node, lnext);              // Help a tail left behind by enqueueBatch()
+                continue;
+            }
+            orc_ptr<Node*,domain> lnext = node->next.load();                   // orc_ptr
+            if (SINGLE_CONSUMER) {
+                head.storeOwned(lnext, node);
+                node->next.poison();
+                return lnext->item;
+            }
             if (head.compare_exchange_strong(node, lnext)) {
             	node->next.poison();
             	return lnext->item;
             }
             node = head.load();
         }
-        return nullptr;                  // Queue is empty
+    }
+
+
+    // Enqueues items[0] to items[n-1], in this order, with a single CAS to insert them all
+    void enqueueBatch(T** items, const int n) {
+        if (n <= 0) return;
+        for (int i = 0; i < n; i++) {
+            if (items[i] == nullptr) throw std::invalid_argument("item can not be nullptr");
+        }
+        // Link the nodes privately. The nodes in the middle are only ever pointed to by their previous node,
+        // so they can be created with their counter already set and linked with init()
+        orc_ptr<Node*,domain> first = make_orc<Node,domain>(items[0]);
+        Node* prev = first;
+        for (int i = 1; i < n-1; i++) {
+            Node* node = make_orc_unpublished<Node,domain>(1, items[i]);
+            prev->next.init(node);
+            prev = node;
+        }
+        orc_ptr<Node*,domain> last = first;
+        if (n > 1) {
+            last = make_orc<Node,domain>(items[n-1]);
+            prev->next.store(last);
+        }
+        if (SINGLE_PRODUCER) {
+            orc_ptr<Node*,domain> ltail = tail.load();
+            ltail->next.storeOwned(first, nullptr);
+            tail.store(last, std::memory_order_release);
+            return;
+        }
+        while (true) {
+            orc_ptr<Node*,domain> ltail = tail.load();              // orc_ptr
+            orc_ptr<Node*,domain> lnext = ltail->next.load();       // orc_ptr
+            if (lnext == nullptr) {
+                if (ltail->next.compare_exchange_strong(nullptr, first)) {
+                	tail.compare_exchange_strong(ltail, last);
+                    return;
+                }
+            } else {
+            	tail.compare_exchange_strong(ltail, lnext);
+            }
+        }
+    }
+
+
+    // Dequeues up to 'max' items into out[], in FIFO order, and returns how many. Returns zero if the queue is empty
+    int dequeueBatch(T** out, const int max) {
+        if (max <= 0) return 0;
+        while (true) {
+            orc_ptr<Node*,domain> node = head.load();                          // orc_ptr
+            orc_ptr<Node*,domain> last = node;                                 // orc_ptr
+            int count = 0;
+            bool poisoned = false;
+            while (count < max) {
+                if (last == tail.load().ptr) {
+                    orc_ptr<Node*,domain> lnext = last->next.load();           // orc_ptr
+                    if (lnext == nullptr) break;
+                    tail.compare_exchange_strong(last, lnext);          // Help a tail left behind by enqueueBatch()
+                }
+                last = last->next.load();
+                // Another thread dequeued this node meanwhile, the CAS on head would fail anyways
+                if (is_poisoned(last)) {
+                    poisoned = true;
+                    break;
+                }
+                out[count++] = last->item;
+            }
+            if (poisoned) continue;
+            if (count == 0) return 0;    // Queue is empty
+            if (SINGLE_CONSUMER) {
+                head.storeOwned(last, node);
+                node->next.poison();
+                return count;
+            }
+            if (head.compare_exchange_strong(node, last)) {
+                node->next.poison();     // The other dequeued nodes are released in a chain from this one
+                return count;
+            }
+        }
     }
 };
 
@@ -220,4 +220,21 @@ public:
         if (lhead == head.load().ptr && myNode == lhead->next.load().ptr) head.compare_exchange_strong(lhead, myNode);
         return myNode->item;
     }
+
+    // The announce/help protocol works on one node per operation, so there is no shared step to amortize over a batch
+    void enqueueBatch(T** items, const int n) {
+        for (int i = 0; i < n; i++) enqueue(items[i]);
+    }
+
+
+    // Dequeues up to 'max' items into out[], in FIFO order, and returns how many. Returns zero if the queue is empty
+    int dequeueBatch(T** out, const int max) {
+        int count = 0;
+        while (count < max) {
+            T* item = dequeue();
+            if (item == nullptr) break;
+            out[count++] = item;
+        }
+        return count;
+    }
 };
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../../trackers/OrcPTP.hpp"
+#include "common/ThreadRegistry.hpp"
+
+using namespace orcgc_ptp;
+
+
+/**
+ * <h1> Vyukov Bounded Queue </h1>
+ *
+ * Bounded Multi-Producer-Multi-Consumer queue, based on the array of sequence-numbered cells by Dmitry Vyukov
+ * https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *
+ * Unlike the other queues in this folder, the items must extend orc_base: each cell holds an orc_atomic<T*>
+ * and dequeue() returns an orc_ptr<T*>, therefore an item stays alive until the last consumer drops its
+ * orc_ptr, even if the queue has let go of it. The caller of enqueue() must hold a hazardous pointer to the
+ * item, for example because it has an orc_ptr to it (see make_orc<T>).
+ * The array of cells is allocated in the constructor and enqueue()/dequeue() never allocate.
+ *
+ * The capacity is rounded up to a power of two. enqueue() returns false when the queue is full and
+ * dequeue() returns an orc_ptr to nullptr when the queue is empty.
+ * In the original algorithm a dequeuer also returns empty when the enqueuer of its cell has taken the position
+ * but not yet stored the item, even if later cells are full (and similarly for enqueue() and full). Here it
+ * waits for that enqueuer instead, so that empty and full are only returned when they are true.
+ *
+ * <p>
+ * enqueue algorithm: Vyukov, CAS on the enqueue position
+ * dequeue algorithm: Vyukov, CAS on the dequeue position
+ * Consistency: Linearizable
+ * enqueue() progress: blocking (a slow enqueuer holds back the dequeuers of its cell)
+ * dequeue() progress: blocking (a slow dequeuer holds back the enqueuers of its cell)
+ * Memory Reclamation: OrcGC (of the items)
+ */
+template<typename T, uint64_t DEFAULT_CAPACITY = 1024>
+class VyukovQueueOrcGC {
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        orc_atomic<T*>        item;
+    };
+
+    alignas(128) std::atomic<uint64_t> enqPos {0};
+    alignas(128) std::atomic<uint64_t> deqPos {0};
+    alignas(128) Cell*                 cells;
+    uint64_t                           mask;
+
+    static uint64_t roundUpPow2(uint64_t n) {
+        uint64_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+public:
+    VyukovQueueOrcGC(const uint64_t capacity = DEFAULT_CAPACITY) {
+        const uint64_t size = roundUpPow2(capacity);
+        mask = size - 1;
+        cells = new Cell[size];
+        for (uint64_t i = 0; i < size; i++) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+
+    ~VyukovQueueOrcGC() {
+        while (dequeue() != nullptr); // Drain the queue
+        delete[] cells;
+    }
+
+    static std::string className() { return "VyukovQueue-OrcGC"; }
+
+    uint64_t capacity() { return mask + 1; }
+
+
+    // Returns false if the queue is full
+    bool enqueue(T* item) {
+        if (item == nullptr) throw std::invalid_argument("item can not be nullptr");
+        uint64_t pos = enqPos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            const int64_t diff = (int64_t)(cell->seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (enqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                if ((int64_t)(pos - deqPos.load()) > (int64_t)mask) return false; // Queue is full
+                std::this_thread::yield();  // The dequeuer of the previous lap has not released the cell yet
+                pos = enqPos.load(std::memory_order_relaxed);
+            } else {
+                pos = enqPos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item.store(item);  // Increments the counter of the item, which is protected by the caller
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    // Returns an orc_ptr to nullptr if the queue is empty
+    orc_ptr<T*> dequeue() {
+        uint64_t pos = deqPos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            const int64_t diff = (int64_t)(cell->seq.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0) {
+                if (deqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                if (enqPos.load() <= pos) return orc_ptr<T*>{}; // Queue is empty
+                std::this_thread::yield();  // The enqueuer of this cell has not stored its item yet
+                pos = deqPos.load(std::memory_order_relaxed);
+            } else {
+                pos = deqPos.load(std::memory_order_relaxed);
+            }
+        }
+        // Protect the item before the cell lets go of it. If that was the last link, the item is handed
+        // over to our hazardous pointer and reclaimed only after the returned orc_ptr is gone
+        orc_ptr<T*> item = cell->item.load();
+        cell->item.store(nullptr);
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        return item;
+    }
+};
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <cmath>
+
+#include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+#include "../../common/SkipListLevel.hpp"
+
+using namespace orcgc_ptp;
+
+
+
+/**
+ * Map version of HerlihyShavitLockFreeSkipListOrcGC, the Lock-free Skiplist in
+ * "The Art of Multiprocessor programming", chapter 14
+ *
+ * The value of each entry is in a separate orc-managed object (ValNode) so that put()
+ * and replace() swap it with a single CAS, without removing and re-inserting the node.
+ * A nullptr value means the entry was removed: this is the linearization point of
+ * remove(), after which the node is marked on all levels and unlinked like in the set.
+ *
+ * <p>
+ * get(), put(), putIfAbsent(), insert(), replace(), innerRemove() - Lock-Free
+ * Memory Reclamation: OrcGC
+ * <p>
+ */
+template<typename K, typename V, typename Layout = PaddedLayout, typename Level = XorshiftLevel<>>
+class HerlihyShavitLockFreeSkipListMapOrcGC {
+
+private:
+
+    static const int MAX_LEVEL = Level::maxLevel;
+
+    struct ValNode : public orc_base {
+        V val;
+        ValNode(V val) : val{val} { }
+    };
+
+    struct alignas(Layout::nodeAlign) Node : orc_base  {
+        K key;
+        orc_atomic<ValNode*> val;
+        orc_atomic<Node*> next[MAX_LEVEL+1];
+        int topLevel;
+
+        Node(K x, ValNode* v) : key{x}, val{v} {
+            for (int i = 0; i <= MAX_LEVEL; i++) next[i] = nullptr;
+            topLevel = MAX_LEVEL;
+        }
+
+        Node(K x, ValNode* v, int hgt): key{x}, val{v} {
+            for (int i = 0; i <= hgt; i++) next[i] = nullptr;
+            topLevel = hgt;
+        }
+
+        void poisonAllLinks() { for (int i = 0; i <= MAX_LEVEL; i++) next[i].poison(); }
+    };
+
+    // Pointers to head and tail sentinel nodes of the skiplist
+    orc_atomic<Node*> head;
+    orc_atomic<Node*> tail;
+
+public:
+
+    HerlihyShavitLockFreeSkipListMapOrcGC() {
+        head = make_orc<Node>(K{}, nullptr);
+        tail = make_orc<Node>(K{}, nullptr);
+        for (int i = 0; i <= MAX_LEVEL; i++) {
+            head->next[i] = tail;
+        }
+    }
+
+
+    // We don't expect the destructor to be called if this instance can still be in use
+    ~HerlihyShavitLockFreeSkipListMapOrcGC() {
+        head = nullptr;
+        tail = nullptr;
+    }
+
+    static std::string className() { return "HerlihyShavit-LockFreeSkipListMapOrcGC" + Layout::suffix() + Level::suffix(); }
+
+    // Size in bytes of each entry, including padding
+    static size_t nodeSize() { return sizeof(Node) + sizeof(ValNode); }
+
+
+    /* Random Level Generator */
+    int random_level() {
+        return Level::randomLevel();
+    }
+
+
+    /**
+     * Returns the value associated with 'key', if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> get(K key) {
+        orc_ptr<Node*> node;
+        if (!search(key, node)) return {};
+        orc_ptr<ValNode*> lval = node->val.load();
+        if (lval == nullptr) return {};
+        return lval->val;
+    }
+
+
+    /**
+     * Associates 'val' with 'key' and returns the previous value, if any.
+     * If 'key' is already in the skiplist, only its value is swapped.
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> put(K key, V val) {
+        orc_ptr<ValNode*> newVal = make_orc<ValNode>(val);
+        orc_ptr<Node*> preds[MAX_LEVEL + 1];
+        orc_ptr<Node*> succs[MAX_LEVEL + 1];
+        while (true) {
+            if (find(key, preds, succs)) {
+                orc_ptr<Node*> node = succs[0];
+                orc_ptr<ValNode*> lval = node->val.load();
+                if (lval == nullptr) {
+                    // Being removed. Help it to get out of the way and try again
+                    markAllLevels(node);
+                    continue;
+                }
+                if (node->val.compare_exchange_strong(lval, newVal)) return lval->val;
+                continue;
+            }
+            if (insertNode(key, newVal, preds, succs)) return {};
+        }
+    }
+
+
+    /**
+     * Associates 'val' with 'key' only if there is no value for 'key'.
+     * Returns the current value if there is one, or an empty optional if 'val' was inserted.
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> putIfAbsent(K key, V val) {
+        orc_ptr<ValNode*> newVal;
+        orc_ptr<Node*> preds[MAX_LEVEL + 1];
+        orc_ptr<Node*> succs[MAX_LEVEL + 1];
+        while (true) {
+            if (find(key, preds, succs)) {
+                orc_ptr<Node*> node = succs[0];
+                orc_ptr<ValNode*> lval = node->val.load();
+                if (lval != nullptr) return lval->val;
+                markAllLevels(node);
+                continue;
+            }
+            if (newVal == nullptr) newVal = make_orc<ValNode>(val);
+            if (insertNode(key, newVal, preds, succs)) return {};
+        }
+    }
+
+
+    // Same as putIfAbsent() but returns true if the new entry was inserted
+    bool insert(K key, V val) {
+        return !putIfAbsent(key, val).has_value();
+    }
+
+
+    /**
+     * Replaces the value of 'key' only if there is one, and returns the previous value
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> replace(K key, V val) {
+        orc_ptr<ValNode*> newVal = make_orc<ValNode>(val);
+        orc_ptr<Node*> node;
+        while (true) {
+            if (!search(key, node)) return {};
+            orc_ptr<ValNode*> lval = node->val.load();
+            if (lval == nullptr) return {};
+            if (node->val.compare_exchange_strong(lval, newVal)) return lval->val;
+        }
+    }
+
+
+    /**
+     * Removes 'key' and returns its value, if any
+     * Progress Condition: Lock-Free
+     */
+    std::optional<V> innerRemove(K key) {
+        orc_ptr<Node*> preds[MAX_LEVEL + 1];
+        orc_ptr<Node*> succs[MAX_LEVEL + 1];
+        while (true) {
+            if (!find(key, preds, succs)) return {};
+            orc_ptr<Node*> node = succs[0];
+            orc_ptr<ValNode*> lval = node->val.load();
+            if (lval == nullptr) return {};
+            if (!node->val.compare_exchange_strong(lval, nullptr)) continue;
+            // Logically removed. Now mark and unlink it
+            markAllLevels(node);
+            find(key, preds, succs);
+            return lval->val;
+        }
+    }
+
+
+    // Wrappers for the "set" benchmarks
+    bool add(K key) { return insert(key, key); }
+
+    bool remove(K key) { return innerRemove(key).has_value(); }
+
+    bool contains(K key) { return get(key).has_value(); }
+
+    void addAll(K** keys, const int size) {
+        for (int i = 0; i < size; i++) add(*keys[i]);
+    }
+
+
+private:
+
+    /**
+     * Links a new node with 'newVal' between preds and succs, like add() in the set.
+     * Returns false if the bottom level changed and the caller must find() again.
+     */
+    bool insertNode(K key, orc_ptr<ValNode*>& newVal, orc_ptr<Node*>* preds, orc_ptr<Node*>* succs) {
+        const int bottomLevel = 0;
+        int topLevel = random_level();
+        orc_ptr<Node*> newNode = make_orc<Node>(key, newVal, topLevel);
+        for (int level = bottomLevel; level <= topLevel; level++) {
+            orc_ptr<Node*> succ = succs[level];
+            newNode->next[level] = succ;
+        }
+        orc_ptr<Node*> pred = preds[bottomLevel];
+        orc_ptr<Node*> succ = succs[bottomLevel];
+        if (!pred->next[bottomLevel].compare_exchange_strong(succ, newNode)) return false;
+        orc_ptr<Node*> next;
+        for (int level = bottomLevel+1; level <= topLevel; level++) {
+            while (true) {
+                pred = preds[level];
+                succ = succs[level];
+                next = newNode->next[level].load();
+                if (isMarked(next)) {
+                    newNode->next[level].poison();
+                    break;
+                } else {
+                    if (!newNode->next[level].compare_exchange_strong(next, succ)) {
+                        newNode->next[level].poison();
+                        break;
+                    }
+                }
+                if (pred->next[level].compare_exchange_strong(succ, newNode)) break;
+                find(key, preds, succs);
+            }
+        }
+        return true;
+    }
+
+    // Marks all the levels of 'node', from the top to the bottom, like remove() in the set
+    void markAllLevels(orc_ptr<Node*>& node) {
+        const int bottomLevel = 0;
+        orc_ptr<Node*> succ;
+        for (int level = node->topLevel; level >= bottomLevel; level--) {
+            succ = node->next[level].load();
+            while (!isMarked(succ)) {
+                node->next[level].compare_exchange_strong(succ, getMarked(succ));
+                succ = node->next[level].load();
+            }
+        }
+    }
+
+    // Same traversal as contains() in the set, returning the node with 'key'
+    bool search(K key, orc_ptr<Node*>& curr) {
+        int bottomLevel = 0;
+        orc_ptr<Node*> pred, succ;
+        restart:
+        pred = head;
+        for (int level = MAX_LEVEL; level >= bottomLevel; level--) {
+            curr.setUnmarked(pred->next[level].load());
+            if (is_poisoned(curr)) goto restart;
+            while (curr!=tail.load()) {
+                succ = curr->next[level].load();
+                while (isMarked(succ)) {
+                    if (is_poisoned(succ)) goto restart;
+                    curr.setUnmarked(succ);
+                    succ = curr->next[level].load();
+                    if(curr==tail.load()) break;
+                }
+                if(curr==tail.load()) break;
+                if (curr->key < key){
+                    pred = curr;
+                    curr.setUnmarked(succ);
+                } else {
+                    break;
+                }
+            }
+        }
+        if (curr==tail.load()) return false;
+        return (curr->key == key && !isMarked(succ));
+    }
+
+    bool find (K key, orc_ptr<Node*>* preds, orc_ptr<Node*>* succs) {
+        int bottomLevel = 0;
+        bool snip;
+        orc_ptr<Node*> pred, curr, succ;
+        retry:
+        pred = head;
+        for (int level = MAX_LEVEL; level >= bottomLevel; level--) {
+            curr = pred->next[level].load();
+            if(curr!=getUnmarked(curr)) goto retry;
+            while (curr != tail) {
+                succ = curr->next[level].load();
+                while (isMarked(succ)) {
+                    if (is_poisoned(succ)) goto retry;
+                    snip = pred->next[level].compare_exchange_strong(curr, getUnmarked(succ));
+                    if (!snip) goto retry;
+                    curr->next[level].poison();
+                    curr = pred->next[level].load();
+                    if(curr!=getUnmarked(curr)) goto retry;
+                    succ = curr->next[level].load();
+                    if(curr==tail) break;
+                }
+                if(curr==tail) break;
+                if (curr->key < key){
+                    pred = curr;
+                    curr.setUnmarked(succ);
+                } else {break;}
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        if (curr==tail.load()) return false;
+        return (curr->key == key && !isMarked(succ));
+    }
+
+    bool isMarked(Node* node) {
+        return ((size_t) node & 0x1ULL);
+    }
+
+    Node * getMarked(Node* node) {
+        return (Node*)((size_t) node | 0x1ULL);
+    }
+
+    Node * getUnmarked(Node* node) {
+        return (Node*)((size_t) node & (~0x1ULL));
+    }
+};
@@ -16,8 +16,15 @@
 #include <string>
 #include <limits>
 #include <cmath>
+#include <vector>
+#include <numeric>
+#include <algorithm>
 
 #include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+#include "../../common/SkipListLevel.hpp"
+#include "../../common/BulkLoad.hpp"
+#include "../../trackers/OrcSnapshot.hpp"
 
 using namespace orcgc_ptp;
 
@@ -35,16 +42,19 @@ using namespace orcgc_ptp;
  * <li>remove(x)   - Lock-Free
  * <li>contains(x) - Wait-Free (bounded by key space)
  * </ul><p>
+ * It also has ordered scans, with range(lo,hi,callback) and with a Cursor from lowerBound(x).
+ * These are Lock-Free and are not snapshots: a key added or removed during the scan may or may not be seen.
+ * With Snap = OrcSnapshot, snapshotRange() and snapshotCount() are linearizable, and range() uses them.
  * <p>
  */
-template<typename T>
+template<typename T, typename Layout = PaddedLayout, typename Level = XorshiftLevel<>, typename Snap = NoSnapshot>
 class HerlihyShavitLockFreeSkipListOrcGC {
 
 private:
 
-    static const int MAX_LEVEL = 16;
+    static const int MAX_LEVEL = Level::maxLevel;
 
-    struct Node : orc_base  {
+    struct alignas(Layout::nodeAlign) Node : orc_base, Snap::template Stamps<Node> {
         T key;
         orc_atomic<Node*> next[MAX_LEVEL+1];
         int topLevel;
@@ -60,11 +70,13 @@ private:
         }
 
         void poisonAllLinks() { for (int i = 0; i <= MAX_LEVEL; i++) next[i].poison(); }
-    } __attribute__((aligned(128)));
+    };
 
     // Pointers to head and tail sentinel nodes of the skiplist
     orc_atomic<Node*> head;
     orc_atomic<Node*> tail;
+    // Stamps and removed nodes for the snapshot scans. Empty with NoSnapshot
+    typename Snap::template Domain<Node> snap;
 
 public:
 
@@ -83,29 +95,28 @@ public:
         tail = nullptr;
     }
 
-    static std::string className() { return "HerlihyShavit-LockFreeSkipListOrcGC" ; }
+    static std::string className() { return "HerlihyShavit-LockFreeSkipListOrcGC" + Layout::suffix() + Level::suffix() + Snap::suffix(); }
 
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
 
-    float frand() {
-        return (float) rand() / RAND_MAX;
-    }
 
     /* Random Level Generator */
     int random_level() {
-        static bool first = true;
-        if (first){
-            srand((unsigned)time(nullptr));
-            first = false;
-        }
-
-        int lvl = (int)(log(frand()) / log(1.-0.5f));
-        return lvl < MAX_LEVEL ? lvl : MAX_LEVEL;
+        return Level::randomLevel();
     }
 
+    /**
+     * If the skiplist is empty, the keys are sorted and linked in a perfectly balanced skiplist
+     * which is then published (see BulkLoad.hpp). Otherwise, calls add() for each key.
+     * Not lock-free, and there must be no concurrent remove() until it returns.
+     */
     void addAll(T** keys, const int size) {
-        for(int i=0;i<size;i++){
-            T* key = keys[i];
-            add(*key);
+        if (!bulkLoad(keys, size)) {
+            for(int i=0;i<size;i++){
+                T* key = keys[i];
+                add(*key);
+            }
         }
     }
 
@@ -120,7 +131,8 @@ public:
         while (true) {
             bool found = find(key, preds, succs);
             if (found) {
-                return false;
+                if (snap.present(succs[bottomLevel])) return false;
+                continue; // It was removed after find() got to it
             } else {
                 orc_ptr<Node*> newNode = make_orc<Node>(key, topLevel);
                 for (int level = bottomLevel; level <= topLevel; level++) {
@@ -133,6 +145,7 @@ public:
                 if (!pred->next[bottomLevel].compare_exchange_strong(succ, newNode)) {
                     continue;
                 }
+                snap.inserted(newNode);
                 orc_ptr<Node*> next;
                 for (int level = bottomLevel+1; level <= topLevel; level++) {
                     while (true) {
@@ -181,14 +194,20 @@ public:
     	            }
     	        }
     	        succ = nodeToRemove->next[bottomLevel].load();
+    	        snap.announce(nodeToRemove);
     	        while (true) {
     	            bool iMarkedIt = nodeToRemove->next[bottomLevel].compare_exchange_strong(getUnmarked(succ), getMarked(succ));
     	            succ = nodeToRemove->next[bottomLevel].load();
     	            if (iMarkedIt) {
+    	                snap.removed(nodeToRemove);
     	                find(key, preds, succs);
     	                return true;
     	            }
-    	            else if (isMarked(succ)) return false;
+    	            else if (isMarked(succ)) {
+    	                snap.unannounce();
+    	                snap.helpRemoved(nodeToRemove);
+    	                return false;
+    	            }
     	        }
             }
     	}
@@ -207,6 +226,7 @@ public:
                 succ = curr->next[level].load();
                 while (isMarked(succ)) {
                 	if (is_poisoned(succ)) goto restart;
+                    if (Snap::enabled && level == bottomLevel && curr->key == key) snap.helpRemoved(curr);
                     curr.setUnmarked(succ);
                     succ = curr->next[level].load();
                     if(curr==tail.load()) break;
@@ -221,12 +241,203 @@ public:
             }
         }
         if (curr==tail.load()) return false;
-        return (curr->key == key && !isMarked(succ));
+        if (!(curr->key == key)) return false;
+        if (isMarked(succ)) {
+            snap.helpRemoved(curr);
+            return false;
+        }
+        return snap.present(curr);
+    }
+
+
+    /**
+     * Forward iterator over level 0, in ascending order of keys.
+     * A Cursor always points to a node that was not marked when it got there, or to the tail.
+     * It holds three orc_ptr however long the scan is, so it must be used only by the thread
+     * that created it, and must not outlive the skiplist.
+     */
+    class Cursor {
+        friend class HerlihyShavitLockFreeSkipListOrcGC;
+        HerlihyShavitLockFreeSkipListOrcGC* sl;
+        orc_ptr<Node*> curr, succ;
+        orc_ptr<Node*> last;  // Last node visited, to restart from if the walk hits a poisoned link
+        const T lo;
+
+        Cursor(HerlihyShavitLockFreeSkipListOrcGC* sl, T key) : sl{sl}, lo{key} {
+            sl->seek(lo, true, curr);
+            settle();
+        }
+
+        // Moves forward until the first node that is not marked
+        void settle() {
+            while (curr != sl->tail.load()) {
+                succ = curr->next[0].load();
+                if (is_poisoned(succ)) {
+                    // curr was unlinked, we can't follow its next
+                    if (last == nullptr) sl->seek(lo, true, curr);
+                    else sl->seek(last->key, false, curr);
+                    continue;
+                }
+                if (!sl->isMarked(succ)) return;
+                curr.setUnmarked(succ);
+            }
+        }
+
+    public:
+        bool valid() { return curr != sl->tail.load(); }
+
+        T key() const { return curr->key; }
+
+        void next() {
+            last = curr;
+            curr.setUnmarked(succ);
+            settle();
+        }
+    };
+
+    // Returns a Cursor on the first key that is equal or greater than 'key'
+    Cursor lowerBound(T key) {
+        return Cursor(this, key);
+    }
+
+    /**
+     * Calls callback(key) on each key in [lo,hi], in ascending order, and returns how many were visited.
+     * This is O(log n + k) instead of k calls to contains().
+     * Progress Condition: Lock-Free
+     */
+    template<typename F>
+    int range(T lo, T hi, F callback) {
+        if (Snap::enabled) return snapshotRange(lo, hi, callback);
+        int count = 0;
+        for (Cursor it = lowerBound(lo); it.valid() && !(hi < it.key()); it.next()) {
+            callback(it.key());
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * Linearizable version of range(), when Snap is OrcSnapshot: the keys are the ones in [lo,hi] at
+     * the time of the snapshot. The nodes that were marked before the cursor got to them are found in
+     * the announcements and limbo lists of the snapshot domain.
+     * The callback is called after the snapshot has ended. Each call allocates a temporary vector.
+     * Progress Condition: Lock-Free
+     */
+    template<typename F>
+    int snapshotRange(T lo, T hi, F callback) {
+        if (hi < lo) return 0;
+        std::vector<T> keys;
+        const uint64_t ts = snap.begin();
+        for (Cursor it = lowerBound(lo); it.valid() && !(hi < it.key()); it.next()) {
+            if (snap.visible(it.curr, ts)) keys.push_back(it.key());
+        }
+        snap.forEachRemoved(ts, [&](Node* node){
+            if (node->key < lo || hi < node->key) return;
+            if (snap.visible(node, ts)) keys.push_back(node->key);
+        });
+        snap.end();
+        // T may not be assignable, so we sort the indexes. A node may have been found more than once
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return keys[a] < keys[b]; });
+        int count = 0;
+        for (size_t i = 0; i < order.size(); i++) {
+            if (i > 0 && !(keys[order[i-1]] < keys[order[i]])) continue;
+            callback(keys[order[i]]);
+            count++;
+        }
+        return count;
+    }
+
+    // Number of keys in [lo,hi]. Linearizable only with OrcSnapshot
+    int snapshotCount(T lo, T hi) {
+        return range(lo, hi, [](const T&){ });
     }
 
 
 private:
 
+    // Height of the i-th node in a perfectly balanced skiplist with the branching factor of Level
+    static int bulkHeight(uint64_t i) {
+        const int lvl = __builtin_ctzll(i+1) / Level::log2Branching;
+        return lvl < MAX_LEVEL ? lvl : MAX_LEVEL;
+    }
+
+    // Distance between two consecutive nodes of height 'level' or more
+    static uint64_t bulkStep(int level) {
+        return (level*Level::log2Branching < 63) ? (1ULL << (level*Level::log2Branching)) : ~0ULL;
+    }
+
+    /*
+     * Returns false if the skiplist was not empty and nothing was done.
+     * At each level, the successor of node i is the next node whose (index+1) is a multiple of bulkStep(level).
+     * The head is linked to the first node of each level only when the bottom level is published, therefore
+     * the counter of a node which is the first of its top level has one link less.
+     * With OrcSnapshot, the nodes are stamped with the clock before they are published, otherwise the
+     * first snapshot would stamp them with a time after its own and miss all of them.
+     */
+    bool bulkLoad(T** keys, const int size) {
+        orc_ptr<Node*> ltail = tail.load();
+        if (head->next[0].load() != ltail) return false;
+        if (size == 0) return true;
+        std::vector<T*> sorted = bulkSortedUnique(keys, size);
+        const int n = (int)sorted.size();
+        std::vector<Node*> nodes(n);
+        const uint64_t stamp = snap.now();
+        orc_ptr<Node*> first = make_orc<Node>(*sorted[0], bulkHeight(0));
+        nodes[0] = first;
+        for (uint64_t i = 1; i < (uint64_t)n; i++) {
+            const int h = bulkHeight(i);
+            const uint64_t links = (i+1 == bulkStep(h)) ? h : h+1;
+            nodes[i] = make_orc_unpublished<Node>(links, *sorted[i], h);
+        }
+        bulkParallelFor(n, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                snap.prestamp(nodes[i], stamp);
+                for (int level = 0; level <= nodes[i]->topLevel; level++) {
+                    const uint64_t j = ((i+1)/bulkStep(level) + 1)*bulkStep(level) - 1;
+                    if (j < (uint64_t)n) nodes[i]->next[level].init(nodes[j]);
+                    else nodes[i]->next[level].store(ltail);
+                }
+            }
+        });
+        if (!head->next[0].compare_exchange_strong(ltail, first)) return false;
+        for (int level = 1; level <= MAX_LEVEL && bulkStep(level) <= (uint64_t)n; level++) {
+            head->next[level].compare_exchange_strong(ltail, nodes[bulkStep(level)-1]);
+        }
+        return true;
+    }
+
+    /*
+     * Same traversal as contains(), leaving in 'curr' the first node of level 0 whose key is
+     * equal or greater than 'key' (or greater, if not inclusive). That node may be marked.
+     */
+    void seek(T key, bool inclusive, orc_ptr<Node*>& curr) {
+        orc_ptr<Node*> pred, succ;
+        restart:
+        pred = head;
+        for (int level = MAX_LEVEL; level >= 0; level--) {
+            curr.setUnmarked(pred->next[level].load());
+            if (is_poisoned(curr)) goto restart;
+            while (curr!=tail.load()) {
+                succ = curr->next[level].load();
+                while (isMarked(succ)) {
+                    if (is_poisoned(succ)) goto restart;
+                    curr.setUnmarked(succ);
+                    succ = curr->next[level].load();
+                    if(curr==tail.load()) break;
+                }
+                if(curr==tail.load()) break;
+                if (curr->key < key || (!inclusive && curr->key == key)){
+                    pred = curr;
+                    curr.setUnmarked(succ);
+                } else {
+                    break;
+                }
+            }
+        }
+    }
+
     bool find (T key, orc_ptr<Node*>* preds, orc_ptr<Node*>* succs) {
         int bottomLevel = 0;
         bool snip;
@@ -240,6 +451,8 @@ private:
 				succ = curr->next[level].load();
 				while (isMarked(succ)) {
 					if (is_poisoned(succ)) goto retry;
+					// A node marked at the bottom level is removed, and must have its delete stamp before it is unlinked
+					if (level == bottomLevel) snap.helpRemoved(curr);
 					snip = pred->next[level].compare_exchange_strong(curr, getUnmarked(succ));
 					if (!snip) goto retry;
 					curr->next[level].poison();
@@ -18,6 +18,8 @@
 #include <cmath>
 
 #include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+#include "../../common/SkipListLevel.hpp"
 
 using namespace orcgc_ptp;
 
@@ -37,14 +39,14 @@ using namespace orcgc_ptp;
  * </ul><p>
  * <p>
  */
-template<typename T>
+template<typename T, typename Layout = PaddedLayout, typename Level = XorshiftLevel<>>
 class HerlihyShavitLockFreeSkipListOrcGCOrig {
 
 private:
 
-    static const int MAX_LEVEL = 16;
+    static const int MAX_LEVEL = Level::maxLevel;
 
-    struct Node : orc_base  {
+    struct alignas(Layout::nodeAlign) Node : orc_base  {
         T key;
         orc_atomic<Node*> next[MAX_LEVEL+1];
         int topLevel;
@@ -60,7 +62,7 @@ private:
         }
 
         void poisonAllLinks() { for (int i = 0; i <= MAX_LEVEL; i++) next[i].poison(); }
-    } __attribute__((aligned(128)));
+    };
 
     // Pointers to head and tail sentinel nodes of the skiplist
     orc_atomic<Node*> head;
@@ -83,23 +85,15 @@ public:
         tail = nullptr;
     }
 
-    static std::string className() { return "HerlihyShavit-LockFreeSkipListOrcGCOrig" ; }
+    static std::string className() { return "HerlihyShavit-LockFreeSkipListOrcGCOrig" + Layout::suffix() + Level::suffix(); }
 
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
 
-    float frand() {
-        return (float) rand() / RAND_MAX;
-    }
 
     /* Random Level Generator */
     int random_level() {
-        static bool first = true;
-        if (first){
-            srand((unsigned)time(nullptr));
-            first = false;
-        }
-
-        int lvl = (int)(log(frand()) / log(1.-0.5f));
-        return lvl < MAX_LEVEL ? lvl : MAX_LEVEL;
+        return Level::randomLevel();
     }
 
     void addAll(T** keys, const int size) {
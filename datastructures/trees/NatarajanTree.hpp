@@ -121,6 +121,9 @@ public:
 
     static std::string className() { return "NatarajanTree-" + Reclaimer<Node>::className(); }
 
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
+
 /*
     std::optional<V> get(K key);
     std::optional<V> put(K key, V val);
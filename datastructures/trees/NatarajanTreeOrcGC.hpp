@@ -18,20 +18,26 @@
 #include <iostream>
 #include <atomic>
 #include <algorithm>
-#include <map>
+#include <climits>
+#include <numeric>
+#include <utility>
 #include <optional>
+#include <vector>
 
 #include "../../trackers/OrcPTP.hpp"
+#include "../../common/NodeLayout.hpp"
+#include "../../common/BulkLoad.hpp"
+#include "../../trackers/OrcSnapshot.hpp"
 
 using namespace orcgc_ptp;
 
 
-template <class K, class V>
+template <class K, class V, class Layout = PaddedLayout, class Snap = NoSnapshot>
 class NatarajanTreeOrcGC {
 private:
 
     /* structs*/
-    struct Node : orc_base {
+    struct alignas(Layout::nodeAlign) Node : orc_base, Snap::template Stamps<Node> {
         int level;
         K key;
         V val;
@@ -40,7 +46,7 @@ private:
 
         Node(K k, V v, Node* l, Node* r,int lev):level(lev),key(k),val(v),left(l),right(r) {};
         Node(K k, V v, Node* l, Node* r):level(-1),key(k),val(v),left(l),right(r) {};
-    } __attribute__((aligned(128)));
+    };
 
     struct SeekRecord {
         orc_ptr<Node*> ancestor;
@@ -56,10 +62,15 @@ private:
         }
     } __attribute__((aligned(128)));
 
+    // Maximum number of pending subtrees in rangeQuery(). Each one takes a hazardous pointer.
+    static const int RQ_STACK_SIZE = 8;
+
     K infK{};
     V defltV{};
     orc_atomic<Node*> r {nullptr};
     orc_atomic<Node*> s {nullptr};
+    // Stamps and removed nodes for the snapshot range queries. Empty with NoSnapshot
+    typename Snap::template Domain<Node> snap;
 
     /* helper functions */
     //flag and tags helpers
@@ -104,7 +115,8 @@ private:
     /* private interfaces */
     void seek(K key, SeekRecord& seekRecord);
     bool cleanup(K key, SeekRecord& seekRecord);
-    void doRangeQuery(Node& k1, Node& k2, orc_ptr<Node*>& root, std::map<K,V>& res);
+    template<typename F> int doRangeQuery(K key1, K key2, F visitor, int maxLen);
+    bool bulkLoad(K** keys, const int size);
 public:
     NatarajanTreeOrcGC() {
         r = make_orc<Node>(infK,defltV,nullptr,nullptr,2);
@@ -123,24 +135,31 @@ public:
         s = nullptr;
     };
 
-    static std::string className() { return "NatarajanTree-OrcGC"; }
+    static std::string className() { return "NatarajanTree-OrcGC" + Layout::suffix() + Snap::suffix(); }
+
+    // Size in bytes of each node, including padding
+    static size_t nodeSize() { return sizeof(Node); }
     std::optional<V> get(K key);
     std::optional<V> put(K key, V val);
     bool insert(K key, V val);
     std::optional<V> innerRemove(K key);
     std::optional<V> replace(K key, V val);
-    std::map<K, V> rangeQuery(K key1, K key2, int& len);
+    template<typename F> int rangeQuery(K key1, K key2, F callback);
+    int rangeQuery(K key1, K key2, std::pair<K,V>* buf, int bufLen);
+    template<typename F> int snapshotRangeQuery(K key1, K key2, F callback, int maxLen=INT_MAX);
+    int rangeCount(K key1, K key2);
 
     // Used only by our tree benchmarks
     bool add(K key);
     bool remove(K key);
     bool contains(K key);
     void addAll(K** keys, const int size);
+    template<typename F> int range(K key1, K key2, F callback);
 };
 
 //-------Definition----------
-template <class K, class V>
-void NatarajanTreeOrcGC<K,V>::seek(K key, SeekRecord& seekRecord){
+template <class K, class V, class Layout, class Snap>
+void NatarajanTreeOrcGC<K,V,Layout,Snap>::seek(K key, SeekRecord& seekRecord){
     /* initialize the seek record using sentinel nodes */
     seekRecord.ancestor = r;
     seekRecord.successor = r->left;
@@ -185,8 +204,8 @@ void NatarajanTreeOrcGC<K,V>::seek(K key, SeekRecord& seekRecord){
     return;
 }
 
-template <class K, class V>
-bool NatarajanTreeOrcGC<K,V>::cleanup(K key, SeekRecord& seekRecord) {
+template <class K, class V, class Layout, class Snap>
+bool NatarajanTreeOrcGC<K,V,Layout,Snap>::cleanup(K key, SeekRecord& seekRecord) {
     orc_ptr<Node*> keyNode = make_orc<Node>(key,defltV,nullptr,nullptr);//node to be compared
     bool res=false;
 
@@ -238,6 +257,28 @@ bool NatarajanTreeOrcGC<K,V>::cleanup(K key, SeekRecord& seekRecord) {
     /* read the flag and address fields */
     orc_ptr<Node*> tmpSibling = siblingAddr->load();
 
+    /* the flagged leaf must have its delete stamp before it can no longer be found */
+    if (tmpChild.getFlag()) snap.helpRemoved(tmpChild.getUnmarked());
+    /*
+     * the CAS below unlinks the whole chain of tagged edges from successor to parent, and with it the
+     * flagged leaves of the other removes that tagged them, which need their delete stamps too
+     */
+    if (Snap::enabled) {
+        orc_ptr<Node*> node = successor;
+        while (node.getUnmarked() != nullptr && node.getUnmarked() != parent.getUnmarked()) {
+            orc_ptr<Node*> child = node->left.load();
+            if (child.getFlag()) snap.helpRemoved(child.getUnmarked());
+            child = node->right.load();
+            if (child.getFlag()) snap.helpRemoved(child.getUnmarked());
+            if (nodeLess(keyNode,node)) {
+                node = node->left.load();
+            } else {
+                node = node->right.load();
+            }
+            node.unmark();
+        }
+    }
+
     /* make the sibling node a direct child of the ancestor node */
     res=successorAddr->compare_exchange_strong(successor,
         mixPtrFlgTg(tmpSibling.getUnmarked(),tmpSibling.getFlag(),false));
@@ -262,17 +303,17 @@ bool NatarajanTreeOrcGC<K,V>::cleanup(K key, SeekRecord& seekRecord) {
 //  return res;
 // }
 
-template <class K, class V>
-std::optional<V> NatarajanTreeOrcGC<K,V>::get(K key){
+template <class K, class V, class Layout, class Snap>
+std::optional<V> NatarajanTreeOrcGC<K,V,Layout,Snap>::get(K key){
     std::optional<V> res={};
     SeekRecord seekRecord;
     seek(key, seekRecord);
-    if (keyEqual(key,seekRecord.leaf)) res = seekRecord.leaf->val;
+    if (keyEqual(key,seekRecord.leaf) && snap.present(seekRecord.leaf.getUnmarked())) res = seekRecord.leaf->val;
     return res;
 }
 
-template <class K, class V>
-std::optional<V> NatarajanTreeOrcGC<K,V>::put(K key, V val){
+template <class K, class V, class Layout, class Snap>
+std::optional<V> NatarajanTreeOrcGC<K,V,Layout,Snap>::put(K key, V val){
     std::optional<V> res={};
     SeekRecord seekRecord;
 
@@ -313,8 +354,9 @@ std::optional<V> NatarajanTreeOrcGC<K,V>::put(K key, V val){
                 newInternal = make_orc<Node>(std::max(key,leaf->key),defltV,newLeft,newRight);
 
             /* try to add the new nodes to the tree */
-            orc_ptr<Node*> tmpExpected = leaf.getUnmarked();
-            if (childAddr->compare_exchange_strong(tmpExpected,newInternal)) {
+            snap.setReplaces(newLeaf, nullptr);
+            if (childAddr->compare_exchange_strong(leaf.getUnmarked(),newInternal)) {
+                snap.inserted(newLeaf);
                 res={};
                 break;//insertion succeeds
             }
@@ -336,16 +378,20 @@ std::optional<V> NatarajanTreeOrcGC<K,V>::put(K key, V val){
                 childAddr=&(parent->left);
             else
                 childAddr=&(parent->right);
+            snap.setReplaces(newLeaf, leaf.getUnmarked());
+            snap.announce(leaf.getUnmarked());
             if(childAddr->compare_exchange_strong(leaf,newLeaf)){
+                snap.replaced(newLeaf, leaf.getUnmarked());
                 break;
             }
+            snap.unannounce();
         }
     }
     return res;
 }
 
-template <class K, class V>
-bool NatarajanTreeOrcGC<K,V>::insert(K key, V val) {
+template <class K, class V, class Layout, class Snap>
+bool NatarajanTreeOrcGC<K,V,Layout,Snap>::insert(K key, V val) {
     bool res=false;
     SeekRecord seekRecord;
 
@@ -386,6 +432,7 @@ bool NatarajanTreeOrcGC<K,V>::insert(K key, V val) {
 
             /* try to add the new nodes to the tree */
             if (childAddr->compare_exchange_strong(seekRecord.leaf,newInternal)){
+                snap.inserted(newLeaf);
                 res=true;
                 break;//insertion succeeds
             } else {  //fails; help conflicting delete operation
@@ -400,16 +447,25 @@ bool NatarajanTreeOrcGC<K,V>::insert(K key, V val) {
                     cleanup(key, seekRecord);
                 }
             }
-        } else { //key exists, insertion fails
+        } else if (snap.present(seekRecord.leaf.getUnmarked())) { //key exists, insertion fails
             res=false;
             break;
+        } else { //key was removed but the leaf is still there; help the delete operation
+            if (nodeLess(newLeaf,seekRecord.parent))
+                childAddr = &(seekRecord.parent->left);
+            else
+                childAddr = &(seekRecord.parent->right);
+            orc_ptr<Node*> tmpChild = childAddr->load();
+            if (tmpChild.getUnmarked()==seekRecord.leaf.getUnmarked() && (tmpChild.getFlag()||tmpChild.getTag())){
+                cleanup(key, seekRecord);
+            }
         }
     }
     return res;
 }
 
-template <class K, class V>
-std::optional<V> NatarajanTreeOrcGC<K,V>::innerRemove(K key){
+template <class K, class V, class Layout, class Snap>
+std::optional<V> NatarajanTreeOrcGC<K,V,Layout,Snap>::innerRemove(K key){
     //printf("innerRemove()\n");
     bool injecting = true;
     std::optional<V> res={};
@@ -438,11 +494,14 @@ std::optional<V> NatarajanTreeOrcGC<K,V>::innerRemove(K key){
 
             /* inject the delete operation into the tree */
             res = leaf->val;
+            snap.announce(leaf.getUnmarked());
             if (childAddr->compare_exchange_strong(leaf.getUnmarked(), mixPtrFlgTg(leaf.getUnmarked(),true,false))) {
                 /* advance to cleanup mode to remove the leaf node */
+                snap.removed(leaf.getUnmarked());
                 injecting=false;
                 if (cleanup(key, seekRecord)) break;
             } else {
+                snap.unannounce();
                 orc_ptr<Node*> tmpChild=childAddr->load();
                 if(tmpChild.getUnmarked()==leaf.getUnmarked() && (tmpChild.getFlag()||tmpChild.getTag())){
                     /*
@@ -470,8 +529,8 @@ std::optional<V> NatarajanTreeOrcGC<K,V>::innerRemove(K key){
     return res;
 }
 
-template <class K, class V>
-std::optional<V> NatarajanTreeOrcGC<K,V>::replace(K key, V val){
+template <class K, class V, class Layout, class Snap>
+std::optional<V> NatarajanTreeOrcGC<K,V,Layout,Snap>::replace(K key, V val){
     std::optional<V> res={};
     SeekRecord seekRecord;
 
@@ -495,73 +554,253 @@ std::optional<V> NatarajanTreeOrcGC<K,V>::replace(K key, V val){
                 childAddr=&(parent->left);
             else
                 childAddr=&(parent->right);
+            snap.setReplaces(newLeaf, leaf.getUnmarked());
+            snap.announce(leaf.getUnmarked());
             if(childAddr->compare_exchange_strong(leaf,newLeaf)){
+                snap.replaced(newLeaf, leaf.getUnmarked());
                 break;
             }
+            snap.unannounce();
         }
     }
     return res;
 }
 
-template <class K, class V>
-std::map<K, V> NatarajanTreeOrcGC<K,V>::rangeQuery(K key1, K key2, int& len){
-    if(key1>key2) return {};
-    Node k1{key1,defltV,nullptr,nullptr};//node to be compared
-    Node k2{key2,defltV,nullptr,nullptr};//node to be compared
-
-    orc_ptr<Node*> leaf = s->left;
-    orc_ptr<Node*> current = leaf->left;
+/*
+ * Calls callback(key,val) for each key in [key1,key2], in ascending order, and returns the number of keys.
+ * With NoSnapshot this is not linearizable: keys inserted or removed during the query may or may not be seen.
+ * With OrcSnapshot this is the same as snapshotRangeQuery().
+ * Progress Condition: Lock-Free
+ */
+template <class K, class V, class Layout, class Snap>
+template <typename F>
+int NatarajanTreeOrcGC<K,V,Layout,Snap>::rangeQuery(K key1, K key2, F callback){
+    if (Snap::enabled) return snapshotRangeQuery(key1, key2, callback);
+    return doRangeQuery(key1, key2, [&](orc_ptr<Node*>& leaf){ callback(leaf->key, leaf->val); return true; }, INT_MAX);
+}
 
-    std::map<K,V> res;
-    if(current.getUnmarked() != nullptr)
-        doRangeQuery(k1,k2,current,res);
-    len=res.size();
-    return res;
+/*
+ * Same as above, but stores the pairs in 'buf' and stops after 'bufLen' keys
+ */
+template <class K, class V, class Layout, class Snap>
+int NatarajanTreeOrcGC<K,V,Layout,Snap>::rangeQuery(K key1, K key2, std::pair<K,V>* buf, int bufLen){
+    int len = 0;
+    auto store = [&](const K& key, const V& val){ buf[len++] = std::make_pair(key, val); };
+    if (Snap::enabled) return snapshotRangeQuery(key1, key2, store, bufLen);
+    return doRangeQuery(key1, key2, [&](orc_ptr<Node*>& leaf){ store(leaf->key, leaf->val); return true; }, bufLen);
 }
 
-template <class K, class V>
-void NatarajanTreeOrcGC<K,V>::doRangeQuery(Node& k1, Node& k2, orc_ptr<Node*>& root, std::map<K,V>& res){
-    orc_ptr<Node*> left = root->left;
-    orc_ptr<Node*> right = root->right;
-    if(left.getUnamrked() == nullptr && right.getUnamrked() == nullptr) {
-        if (nodeLessEqual(k1,root) && nodeLessEqual(root,&k2)){
-            res.emplace(root->key,root->val);
-        }
-        return;
+/*
+ * Linearizable range query, when Snap is OrcSnapshot. Calls callback(key,val) for each key in [key1,key2]
+ * that was in the tree at the time of the snapshot, in ascending order, up to 'maxLen' keys.
+ * The leaves that were removed during the traversal are found in the announcements and limbo lists of
+ * the snapshot domain, which keep them from being reclaimed.
+ * The callback is called after the snapshot has ended. Each call allocates a temporary vector.
+ * Progress Condition: Lock-Free
+ */
+template <class K, class V, class Layout, class Snap>
+template <typename F>
+int NatarajanTreeOrcGC<K,V,Layout,Snap>::snapshotRangeQuery(K key1, K key2, F callback, int maxLen){
+    if (key2 < key1 || maxLen <= 0) return 0;
+    std::vector<std::pair<K,V>> items;
+    const uint64_t ts = snap.begin();
+    doRangeQuery(key1, key2, [&](orc_ptr<Node*>& leaf){
+        if (!snap.visible(leaf, ts)) return false;
+        items.emplace_back(leaf->key, leaf->val);
+        return true;
+    }, INT_MAX);
+    snap.forEachRemoved(ts, [&](Node* leaf){
+        if (leaf->key < key1 || key2 < leaf->key) return;
+        if (snap.visible(leaf, ts)) items.emplace_back(leaf->key, leaf->val);
+    });
+    snap.end();
+    // K may not be assignable, so we sort the indexes. A leaf may have been found more than once
+    std::vector<size_t> order(items.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return items[a].first < items[b].first; });
+    int count = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i > 0 && !(items[order[i-1]].first < items[order[i]].first)) continue;
+        callback(items[order[i]].first, items[order[i]].second);
+        if (++count == maxLen) break;
     }
-    if(left.getUnamrked() != nullptr){
-        if(nodeLess(&k1,root)){
-            doRangeQuery(k1,k2,left,res);
+    return count;
+}
+
+/*
+ * Returns the number of keys in [key1,key2]. Linearizable only with OrcSnapshot.
+ * Progress Condition: Lock-Free
+ */
+template <class K, class V, class Layout, class Snap>
+int NatarajanTreeOrcGC<K,V,Layout,Snap>::rangeCount(K key1, K key2){
+    return rangeQuery(key1, key2, [](const K&, const V&){ });
+}
+
+/*
+ * Iterative in-order traversal of the subtrees that intersect [key1,key2], with an explicit stack.
+ * Calls visitor(leaf) for each leaf in the range, which returns false if the leaf is not to be counted.
+ * Left subtrees have keys smaller than the key of their parent, and right subtrees have equal or larger keys.
+ *
+ * The stack has at most RQ_STACK_SIZE entries (and hazardous pointers) regardless of the height of the tree,
+ * and apart from them only 'current', 'left' and 'right' take hazardous pointers. Everything else that is
+ * needed to resume the traversal is kept as keys.
+ * Every entry below the top is the right subtree of a node whose left subtree was pushed after it,
+ * therefore the newer entries have smaller keys. When the stack is full we drop the oldest entry and
+ * remember the key of its parent in 'resume'. Once the stack is empty, the traversal starts again from
+ * the root for the keys that are equal or larger than 'resume'. The left subtree of that parent was pushed,
+ * which means 'resume' is above the previous lower bound, and therefore each restart makes progress.
+ */
+template <class K, class V, class Layout, class Snap>
+template <typename F>
+int NatarajanTreeOrcGC<K,V,Layout,Snap>::doRangeQuery(K key1, K key2, F visitor, int maxLen){
+    if (key2 < key1 || maxLen <= 0) return 0;
+    orc_ptr<Node*> stack[RQ_STACK_SIZE];
+    std::optional<K> parents[RQ_STACK_SIZE]; // Key of the node whose right subtree is in stack[], if any
+    int base = 0;                            // Index of the oldest entry
+    int len = 0;                             // Number of entries
+    std::optional<K> low;                    // The lower bound is low, or key1 if there is none
+    std::optional<K> resume;                 // Key of the parent of the last dropped subtree, if any
+    std::optional<K> last;                   // Key of the last leaf accepted by the visitor, if any
+    orc_ptr<Node*> current, left, right;
+    int count = 0;
+
+    auto isAboveLow = [&](const K& key) { return !low ? !(key < key1) : !(key < *low); };
+    auto isBelowKey = [&](const K& key) { return !low ? key1 < key : *low < key; };
+    auto push = [&](const orc_ptr<Node*>& node, const K* parentKey) {
+        if (len == RQ_STACK_SIZE) {
+            if (parents[base]) resume.emplace(*parents[base]);
+            else resume.reset();
+            stack[base] = nullptr;
+            parents[base].reset();
+            base = (base+1) % RQ_STACK_SIZE;
+            len--;
         }
-    }
-    if(right!=nullptr){
-        if(nodeLessEqual(root,&k2)){
-            doRangeQuery(k1,k2,right,res);
+        const int i = (base+len) % RQ_STACK_SIZE;
+        stack[i] = node;
+        if (parentKey != nullptr) parents[i].emplace(*parentKey);
+        len++;
+    };
+
+    while (true) {
+        current = s->left.load();
+        current = current->left.load();
+        current.unmark();
+        if (current == nullptr) return count;
+        push(current, nullptr);
+        while (len > 0) {
+            len--;
+            const int i = (base+len) % RQ_STACK_SIZE;
+            current = stack[i];
+            current.unmark();
+            stack[i] = nullptr;
+            parents[i].reset();
+            left = current->left.load();
+            right = current->right.load();
+            left.unmark();
+            right.unmark();
+            if (left == nullptr && right == nullptr) {
+                // Leaf. Skip it if it's not after the last one we gave, because the tree may have changed
+                if (!isAboveLow(current->key) || key2 < current->key) continue;
+                if (last && !(*last < current->key)) continue;
+                if (!visitor(current)) continue;
+                last.emplace(current->key);
+                if (++count == maxLen) return count;
+                continue;
+            }
+            // Internal node: push the right subtree first so that the left subtree is visited first
+            if (right != nullptr && !(key2 < current->key)) push(right, &current->key);
+            if (left != nullptr && isBelowKey(current->key)) push(left, nullptr);
         }
+        if (!resume) return count;
+        // Some subtrees were dropped. Start again from the root for the keys >= resume
+        low.emplace(*resume);
+        resume.reset();
     }
-    return;
 }
 
 
 // Wrappers for the "set" benchmarks
-template <class K, class V>
-bool NatarajanTreeOrcGC<K,V>::add(K key) {
+template <class K, class V, class Layout, class Snap>
+bool NatarajanTreeOrcGC<K,V,Layout,Snap>::add(K key) {
     return insert(key,key);
 }
 
-template <class K, class V>
-bool NatarajanTreeOrcGC<K,V>::remove(K key) {
+template <class K, class V, class Layout, class Snap>
+bool NatarajanTreeOrcGC<K,V,Layout,Snap>::remove(K key) {
     return innerRemove(key).has_value();
 }
 
-template <class K, class V>
-bool NatarajanTreeOrcGC<K,V>::contains(K key) {
+template <class K, class V, class Layout, class Snap>
+bool NatarajanTreeOrcGC<K,V,Layout,Snap>::contains(K key) {
     return get(key).has_value();
 }
 
-// Not lock-free
-template <class K, class V>
-void NatarajanTreeOrcGC<K,V>::addAll(K** keys, const int size) {
+/*
+ * If the tree is empty, the keys are sorted and a balanced tree is built with them and then
+ * published with a single CAS (see BulkLoad.hpp). Otherwise, calls add() for each key.
+ * Not lock-free
+ */
+template <class K, class V, class Layout, class Snap>
+void NatarajanTreeOrcGC<K,V,Layout,Snap>::addAll(K** keys, const int size) {
+    if (bulkLoad(keys, size)) return;
     for (int i = 0; i < size; i++) add(*keys[i]);
 }
 
+/*
+ * Returns false if the tree was not empty and nothing was done.
+ * The tree is built bottom-up, one level at a time, by pairing the subtrees of the level below.
+ * The key of each internal node is the smallest key of its right subtree, like in insert().
+ * Each node has a single link to it, from its parent.
+ * With OrcSnapshot, the leaves are stamped with the clock before they are published, otherwise the
+ * first snapshot would stamp them with a time after its own and miss all of them.
+ */
+template <class K, class V, class Layout, class Snap>
+bool NatarajanTreeOrcGC<K,V,Layout,Snap>::bulkLoad(K** keys, const int size) {
+    orc_ptr<Node*> leaf0 = s->left.load();
+    orc_ptr<Node*> child = leaf0->left.load();
+    if (child != nullptr) return false;
+    if (size == 0) return true;
+    std::vector<K*> sorted = bulkSortedUnique(keys, size);
+    const int n = (int)sorted.size();
+    std::vector<Node*> level(n);
+    std::vector<int> mins(n);   // Index in 'sorted' of the smallest key of each subtree in 'level'
+    const uint64_t stamp = snap.now();
+    for (int i = 0; i < n; i++) level[i] = make_orc_unpublished<Node>(1, *sorted[i], *sorted[i], nullptr, nullptr);
+    bulkParallelFor(n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            snap.prestamp(level[i], stamp);
+            mins[i] = i;
+        }
+    });
+    while (level.size() > 1) {
+        const int m = (int)level.size();
+        std::vector<Node*> upper((m+1)/2);
+        std::vector<int> upperMins((m+1)/2);
+        for (int p = 0; p < m/2; p++) upper[p] = make_orc_unpublished<Node>(1, *sorted[mins[2*p+1]], defltV, nullptr, nullptr);
+        bulkParallelFor(m/2, [&](int begin, int end) {
+            for (int p = begin; p < end; p++) {
+                upper[p]->left.init(level[2*p]);
+                upper[p]->right.init(level[2*p+1]);
+                upperMins[p] = mins[2*p];
+            }
+        });
+        if (m % 2 == 1) {
+            upper[m/2] = level[m-1];
+            upperMins[m/2] = mins[m-1];
+        }
+        level.swap(upper);
+        mins.swap(upperMins);
+    }
+    // Same as the first insert() in an empty tree: an internal node of level 0 with the inf0 leaf on its right
+    orc_ptr<Node*> top = make_orc<Node>(infK,defltV,nullptr,nullptr,0);
+    top->left.init(level[0]);
+    top->right.store(leaf0);
+    return s->left.compare_exchange_strong(leaf0, top);
+}
+
+template <class K, class V, class Layout, class Snap>
+template <typename F>
+int NatarajanTreeOrcGC<K,V,Layout,Snap>::range(K key1, K key2, F callback) {
+    return rangeQuery(key1, key2, [&](const K& key, const V&){ callback(key); });
+}
+
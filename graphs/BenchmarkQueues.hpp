@@ -17,12 +17,18 @@
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <type_traits>
+
+#include "trackers/OrcPTP.hpp"
+#include "MemorySampler.hpp"
+#include "LatencyHistogram.hpp"
 
 
 using namespace std;
 using namespace chrono;
 
-struct UserData  {
+// Extends orc_base so that it can also be an item of the queues that manage their items with OrcGC (VyukovQueueOrcGC)
+struct UserData : orcgc_ptp::orc_base {
     long long seq;
     int tid;
     UserData(long long lseq, int ltid) {
@@ -93,17 +99,57 @@ private:
     static const long long NSEC_IN_SEC = 1000000000LL;
 
     int numThreads;
+    MemorySampler* sampler;
+    LatencyTable* latency;
+
+    // With -DUSE_ORC_STATS, prints what the default OrcGC domain did since 'before'
+    void printOrcStats(const orcgc_ptp::OrcStats& before) {
+        if (!orcgc_ptp::OrcStats::enabled) return;
+        const auto delta = orcgc_ptp::g_ptp.getStats() - before;
+        if (delta.retired != 0) delta.print(std::cout); // Skip the data structures that don't use OrcGC
+    }
+
+    // True for the bounded queues (VyukovQueueOrcGC), whose enqueue() returns false when they are full
+    template<typename Q>
+    static constexpr bool isBounded() {
+        return std::is_same<decltype(std::declval<Q*>()->enqueue(std::declval<UserData*>())), bool>::value;
+    }
+
+    // The bounded queues return false from enqueue() when they are full: retry until there is room and
+    // return how many times the item was rejected. For the other queues this is a plain enqueue()
+    template<typename Q>
+    static long long enqueueRetry(Q* queue, UserData* item) {
+        if constexpr (isBounded<Q>()) {
+            long long rejected = 0;
+            while (!queue->enqueue(item)) {
+                rejected++;
+                this_thread::yield();
+            }
+            return rejected;
+        } else {
+            queue->enqueue(item);
+            return 0;
+        }
+    }
+
+    static void printRejected(const long long rejected, const int numRuns) {
+        if (rejected != 0) cout << "Rejected enqueues per run = " << rejected/numRuns << "\n";
+    }
 
 public:
 
-    BenchmarkQueues(int numThreads) {
+    BenchmarkQueues(int numThreads, MemorySampler* sampler=nullptr, LatencyTable* latency=nullptr) {
         this->numThreads = numThreads;
+        this->sampler = sampler;
+        this->latency = (latency != nullptr && latency->enabled()) ? latency : nullptr;
     }
 
 
     /**
      * enqueue-dequeue pairs: in each iteration a thread executes an enqueue followed by a dequeue;
      * the benchmark executes 10^8 pairs partitioned evenly among all threads;
+     * With a LatencyTable, each enqueue() and dequeue() of the measurement phase is timed with steady_clock,
+     * which lowers the throughput, and the percentiles of all the runs are added to the table.
      */
     template<typename Q>
     uint64_t enqDeq(std::string& className, const long numPairs, const int numRuns) {
@@ -112,23 +158,33 @@ public:
         Q* queue = nullptr;
         className = Q::className();
         cout << "##### " << className << " #####  \n";
-
-        auto enqdeq_lambda = [this,&startFlag,&numPairs,&queue](nanoseconds *delta, const int tid) {
-            UserData ud(0,0);
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+        std::vector<LatencyHistogram> hists((latency != nullptr) ? numThreads : 0);
+        atomic<long long> rejected = { 0 };
+
+        auto enqdeq_lambda = [this,&startFlag,&numPairs,&queue,&hists,&rejected](nanoseconds *delta, const int tid) {
+            orcgc_ptp::orc_ptr<UserData*> ud = orcgc_ptp::make_orc<UserData>(0,0);
+            LatencyHistogram* hist = (latency != nullptr) ? &hists[tid] : nullptr;
+            steady_clock::time_point t;
+            long long myRejected = 0;
             while (!startFlag.load()) {} // Spin until the startFlag is set
             // Warmup phase
             for (long long iter = 0; iter < kNumPairsWarmup/numThreads; iter++) {
-                queue->enqueue(&ud);
+                myRejected += enqueueRetry(queue, ud);
                 if (queue->dequeue() == nullptr) cout << "Error at warmup dequeueing iter=" << iter << "\n";
             }
             // Measurement phase
             auto startBeats = steady_clock::now();
             for (long long iter = 0; iter < numPairs/numThreads; iter++) {
-                queue->enqueue(&ud);
+                if (hist != nullptr) t = steady_clock::now();
+                myRejected += enqueueRetry(queue, ud);
+                if (hist != nullptr) t = hist->recordSince(t);
                 if (queue->dequeue() == nullptr) cout << "Error at measurement dequeueing iter=" << iter << "\n";
+                if (hist != nullptr) hist->recordSince(t);
             }
             auto stopBeats = steady_clock::now();
             *delta = stopBeats - startBeats;
+            rejected.fetch_add(myRejected);
         };
 
         for (int irun = 0; irun < numRuns; irun++) {
@@ -136,9 +192,11 @@ public:
             thread enqdeqThreads[numThreads];
             for (int tid = 0; tid < numThreads; tid++) enqdeqThreads[tid] = thread(enqdeq_lambda, &deltas[tid][irun], tid);
             startFlag.store(true);
+            if (sampler != nullptr) sampler->start(className, -1, numThreads, irun);
             // Sleep for 2 seconds just to let the threads see the startFlag
             this_thread::sleep_for(2s);
             for (int tid = 0; tid < numThreads; tid++) enqdeqThreads[tid].join();
+            if (sampler != nullptr) sampler->stop();
             startFlag.store(false);
             delete (Q*)queue;
         }
@@ -157,12 +215,151 @@ public:
         auto median = agg[numRuns/2].count()/numThreads; // Normalize back to per-thread time (mean of time for this run)
 
         cout << "Total Ops/sec = " << numPairs*2*NSEC_IN_SEC/median << "\n";
+        printRejected(rejected.load(), numRuns);
+        printOrcStats(orcStatsBefore);
+        if (latency != nullptr) {
+            LatencyHistogram latencyAll;
+            for (auto& hist : hists) latencyAll.merge(hist);
+            latency->add(className, -1, numThreads, latencyAll);
+        }
         return (numPairs*2*NSEC_IN_SEC/median);
     }
 
 
+    /**
+     * enqueue-dequeue batches: the same as enqDeq() but each thread does an enqueueBatch() of 'batchSize' items
+     * followed by dequeueBatch() calls until it got 'batchSize' items back. Each pair counts as two operations.
+     */
+    template<typename Q>
+    uint64_t enqDeqBatch(std::string& className, const long numPairs, const int numRuns, const int batchSize) {
+        nanoseconds deltas[numThreads][numRuns];
+        atomic<bool> startFlag = { false };
+        Q* queue = nullptr;
+        className = Q::className() + "-Batch" + std::to_string(batchSize);
+        cout << "##### " << className << " #####  \n";
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+
+        auto enqdeq_lambda = [this,&startFlag,&numPairs,&queue,batchSize](nanoseconds *delta, const int) {
+            orcgc_ptp::orc_ptr<UserData*> ud = orcgc_ptp::make_orc<UserData>(0,0);
+            std::vector<UserData*> items(batchSize, (UserData*)ud);
+            std::vector<UserData*> out(batchSize);
+            auto enqdeqBatch = [&](const char* phase, long long iter) {
+                queue->enqueueBatch(items.data(), batchSize);
+                for (int count = 0; count < batchSize;) {
+                    int n = queue->dequeueBatch(out.data()+count, batchSize-count);
+                    if (n == 0) {
+                        cout << "Error at " << phase << " dequeueing iter=" << iter << "\n";
+                        break;
+                    }
+                    count += n;
+                }
+            };
+            while (!startFlag.load()) {} // Spin until the startFlag is set
+            // Warmup phase
+            for (long long iter = 0; iter < kNumPairsWarmup/numThreads; iter += batchSize) enqdeqBatch("warmup", iter);
+            // Measurement phase
+            auto startBeats = steady_clock::now();
+            for (long long iter = 0; iter < numPairs/numThreads; iter += batchSize) enqdeqBatch("measurement", iter);
+            auto stopBeats = steady_clock::now();
+            *delta = stopBeats - startBeats;
+        };
+
+        for (int irun = 0; irun < numRuns; irun++) {
+            queue = new Q();
+            thread enqdeqThreads[numThreads];
+            for (int tid = 0; tid < numThreads; tid++) enqdeqThreads[tid] = thread(enqdeq_lambda, &deltas[tid][irun], tid);
+            startFlag.store(true);
+            if (sampler != nullptr) sampler->start(className, -1, numThreads, irun);
+            // Sleep for 2 seconds just to let the threads see the startFlag
+            this_thread::sleep_for(2s);
+            for (int tid = 0; tid < numThreads; tid++) enqdeqThreads[tid].join();
+            if (sampler != nullptr) sampler->stop();
+            startFlag.store(false);
+            delete (Q*)queue;
+        }
+
+        // Sum up all the time deltas of all threads so we can find the median run
+        vector<nanoseconds> agg(numRuns);
+        for (int irun = 0; irun < numRuns; irun++) {
+            agg[irun] = 0ns;
+            for (int tid = 0; tid < numThreads; tid++) {
+                agg[irun] += deltas[tid][irun];
+            }
+        }
+
+        // Compute the median. numRuns should be an odd number
+        sort(agg.begin(),agg.end());
+        auto median = agg[numRuns/2].count()/numThreads; // Normalize back to per-thread time (mean of time for this run)
+
+        cout << "Total Ops/sec = " << numPairs*2*NSEC_IN_SEC/median << "\n";
+        printOrcStats(orcStatsBefore);
+        return (numPairs*2*NSEC_IN_SEC/median);
+    }
+
+
+    /**
+     * Inbox: numThreads producers enqueue numItems items in total, while one extra thread, the consumer,
+     * dequeues all of them. This is how the single-consumer queues are meant to be used (with numThreads=1
+     * for the single-producer ones). Returns the median of the number of items per second that went through.
+     * With a bounded queue, the producers fill it up and retry their rejected enqueues until the consumer makes room.
+     */
+    template<typename Q>
+    uint64_t inbox(std::string& className, const long long numItems, const int numRuns) {
+        vector<nanoseconds> deltas(numRuns);
+        atomic<bool> startFlag = { false };
+        Q* queue = nullptr;
+        className = Q::className();
+        cout << "##### " << className << " #####  \n";
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+        const long long itemsPerProducer = numItems/numThreads;
+        atomic<long long> rejected = { 0 };
+
+        auto producer_lambda = [&startFlag,&queue,&rejected,itemsPerProducer](const int tid) {
+            orcgc_ptp::orc_ptr<UserData*> ud = orcgc_ptp::make_orc<UserData>(0,tid);
+            long long myRejected = 0;
+            while (!startFlag.load()) {} // Spin until the startFlag is set
+            for (long long iter = 0; iter < itemsPerProducer; iter++) myRejected += enqueueRetry(queue, ud);
+            rejected.fetch_add(myRejected);
+        };
+
+        auto consumer_lambda = [this,&startFlag,&queue,itemsPerProducer](nanoseconds *delta) {
+            while (!startFlag.load()) {} // Spin until the startFlag is set
+            auto startBeats = steady_clock::now();
+            for (long long count = 0; count < itemsPerProducer*numThreads;) {
+                if (queue->dequeue() != nullptr) count++;
+                else if constexpr (isBounded<Q>()) this_thread::yield(); // Let the producers run when they are waiting for room
+            }
+            auto stopBeats = steady_clock::now();
+            *delta = stopBeats - startBeats;
+        };
+
+        for (int irun = 0; irun < numRuns; irun++) {
+            queue = new Q();
+            thread producerThreads[numThreads];
+            for (int tid = 0; tid < numThreads; tid++) producerThreads[tid] = thread(producer_lambda, tid);
+            thread consumerThread(consumer_lambda, &deltas[irun]);
+            startFlag.store(true);
+            if (sampler != nullptr) sampler->start(className, -1, numThreads, irun);
+            for (int tid = 0; tid < numThreads; tid++) producerThreads[tid].join();
+            consumerThread.join();
+            if (sampler != nullptr) sampler->stop();
+            startFlag.store(false);
+            delete (Q*)queue;
+        }
+
+        // Compute the median. numRuns should be an odd number
+        sort(deltas.begin(),deltas.end());
+        const uint64_t itemsPerSec = itemsPerProducer*numThreads*NSEC_IN_SEC/deltas[numRuns/2].count();
+        cout << "Items/sec = " << itemsPerSec << "\n";
+        printRejected(rejected.load(), numRuns);
+        printOrcStats(orcStatsBefore);
+        return itemsPerSec;
+    }
+
+
     /**
      * Start with only enqueues 100K/numThreads, wait for them to finish, then do only dequeues but only 100K/numThreads
+     * A bounded queue must have room for the whole burst. Its warmup is done in enqueue/dequeue pairs.
      */
     template<typename Q>
     void burst(std::string& className, uint64_t& resultsEnq, uint64_t& resultsDeq,
@@ -172,15 +369,24 @@ public:
         atomic<bool> startDeq = { false };
         atomic<long> barrier = { 0 };
         Q* queue = nullptr;
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
 
         auto burst_lambda = [this,&startEnq,&startDeq,&burstSize,&barrier,&numIters,&isSC,&queue](Result *res, const int tid) {
-            UserData ud(0,0);
+            orcgc_ptp::orc_ptr<UserData*> ud = orcgc_ptp::make_orc<UserData>(0,0);
             // Warmup only if it is not Single-Consumer
             if (!isSC) {
                 const long long warmupIters = 100000LL;  // Do 100K for each thread as a warmup
-                for (long long iter = 0; iter < warmupIters; iter++) queue->enqueue(&ud);
-                for (long long iter = 0; iter < warmupIters; iter++) {
-                    if (queue->dequeue() == nullptr) cout << "ERROR: warmup dequeued nullptr in iter=" << iter << "\n";
+                if constexpr (isBounded<Q>()) {
+                    // In pairs, because the 100K items of all the threads may not fit in a queue sized for the burst
+                    for (long long iter = 0; iter < warmupIters; iter++) {
+                        enqueueRetry(queue, ud);
+                        if (queue->dequeue() == nullptr) cout << "ERROR: warmup dequeued nullptr in iter=" << iter << "\n";
+                    }
+                } else {
+                    for (long long iter = 0; iter < warmupIters; iter++) queue->enqueue(ud);
+                    for (long long iter = 0; iter < warmupIters; iter++) {
+                        if (queue->dequeue() == nullptr) cout << "ERROR: warmup dequeued nullptr in iter=" << iter << "\n";
+                    }
                 }
             }
             // Measurements
@@ -189,7 +395,7 @@ public:
                 while (!startEnq.load()) {} // spin is better than yield here
                 auto startBeats = steady_clock::now();
                 for (long long i = 0; i < burstSize/numThreads; i++) {
-                    queue->enqueue(&ud);
+                    queue->enqueue(ud);
                 }
                 auto stopBeats = steady_clock::now();
                 res->nsEnq += (stopBeats-startBeats);
@@ -236,6 +442,7 @@ public:
             }
             thread burstThreads[numThreads];
             for (int tid = 0; tid < numThreads; tid++) burstThreads[tid] = thread(burst_lambda, &results[tid][irun], tid);
+            if (sampler != nullptr) sampler->start(className, -1, numThreads, irun);
             this_thread::sleep_for(100ms);
             for (int iter=0; iter < numIters; iter++) {
                 // enqueue round
@@ -252,6 +459,7 @@ public:
                 if (!barrier.compare_exchange_strong(tmp, 0)) cout << "ERROR: CAS\n";
             }
             for (int tid = 0; tid < numThreads; tid++) burstThreads[tid].join();
+            if (sampler != nullptr) sampler->stop();
             delete queue;
         }
 
@@ -279,6 +487,7 @@ public:
 
         // Printed value is the median of the number of ops per second that all threads were able to accomplish (on average)
         cout << "Enq/sec = " << allThreadsEnqPerSec << "   Deq/sec = " << allThreadsDeqPerSec << "\n";
+        printOrcStats(orcStatsBefore);
         resultsEnq = allThreadsEnqPerSec;
         resultsDeq = allThreadsDeqPerSec;
     }
@@ -18,6 +18,11 @@
 #include <algorithm>
 #include <iostream>
 
+#include "trackers/OrcPTP.hpp"
+#include "MemorySampler.hpp"
+#include "LatencyHistogram.hpp"
+#include "KeyDistribution.hpp"
+
 using namespace std;
 using namespace chrono;
 
@@ -132,95 +137,218 @@ private:
     static const long long NSEC_IN_SEC = 1000000000LL;
 
     int numThreads;
+    MemorySampler* sampler;
+    LatencyTable* latency;
+    std::vector<long long> targetRates;          // Open-loop rates (total ops/sec), see benchmarkOpenLoop()
+    LatencyTable* openLoopTable {nullptr};
+    std::string keyDistribution {"uniform"};     // See KeyDistribution.hpp
+    bool bulk {false};                           // Fill the sets with addAll(), see fill()
+    steady_clock::time_point runStart;           // When the threads of the current run of runThreads() were started
+
+    // Prints the number of bytes per node, for the sets that have nodeSize()
+    template<typename S>
+    auto printNodeSize(int) -> decltype(S::nodeSize(), void()) {
+        std::cout << "Bytes per node = " << S::nodeSize() << "\n";
+    }
+    template<typename S>
+    void printNodeSize(long) { }
 
-public:
-    BenchmarkSets(int numThreads) {
-        this->numThreads = numThreads;
+    // Adds the keys one at a time, which gives the same initial shape as in the other sets (and the random
+    // levels of the skiplists). With 'randomHalf', half of the keys are first added in random order.
+    // With setBulkLoad(true) it calls addAll() on the empty set instead, which bulk loads some of the sets,
+    // and there is no random half because addAll() only bulk loads an empty set. Prints how long it took
+    template<typename S, typename K>
+    void fill(S* set, K** keys, const int numKeys, const bool randomHalf=false) {
+        auto startBeats = steady_clock::now();
+        if (bulk) {
+            set->addAll(keys, numKeys);
+        } else {
+            if (randomHalf) {
+                long ielem = 0;
+                uint64_t seed = 1234567890123456781ULL;
+                while (ielem < numKeys/2) {
+                    seed = randomLong(seed);
+                    // Insert new random keys until we have 'numKeys/2' keys in the set
+                    if (set->add(*keys[seed%(numKeys)])) ielem++;
+                }
+            }
+            for (int i = 0; i < numKeys; i++) set->add(*keys[i]);
+        }
+        std::cout << "Fill time = " << duration_cast<milliseconds>(steady_clock::now()-startBeats).count() << " ms\n";
     }
 
+    // With -DUSE_ORC_STATS, prints what the default OrcGC domain did since 'before'
+    void printOrcStats(const orcgc_ptp::OrcStats& before) {
+        if (!orcgc_ptp::OrcStats::enabled) return;
+        const auto delta = orcgc_ptp::g_ptp.getStats() - before;
+        if (delta.retired != 0) delta.print(std::cout); // Skip the data structures that don't use OrcGC
+    }
+
+    // What the threads did in runThreads()
+    struct RunCounts {
+        long long ops = 0;           // Operations, where a successful remove() followed by add() counts as two
+        long long keys = 0;          // Keys visited by range(), see benchmarkScans()
+    };
 
     /**
-     * When doing "updates" we execute a random removal and if the removal is successful we do an add() of the
-     * same item immediately after. This keeps the size of the data structure equal to the original size (minus
-     * MAX_THREADS items at most) which gives more deterministic results.
+     * Runs 'numThreads' threads for 'testLengthSeconds', 'numRuns' times. Each thread calls
+     * op(tid, updateRatio, seed, dist, counts) in a loop until the end of the run, with its own random 'seed'
+     * and copy of 'keyDist', and op() adds to 'counts' what it did.
+     * With 'dedicated', threads 0 and 1 only do updates and are not accounted for.
+     * Returns the counts per second of all the threads together, for each run.
      */
-    template<typename S, typename K>
-    long long benchmark(std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numRuns, const int numElements, const bool dedicated=false) {
-        long long ops[numThreads][numRuns];
-        long long lengthSec[numRuns];
+    template<typename F>
+    std::vector<RunCounts> runThreads(const std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numRuns,
+                                      const KeyDistribution& keyDist, const F& op, const bool dedicated=false, const int firstRun=0) {
         atomic<bool> quit = { false };
         atomic<bool> startFlag = { false };
+        std::vector<RunCounts> perSec(numRuns);
 
-        className = S::className();
-        std::cout << "##### " << S::className() << " #####  \n";
-        S* set = new S();
-        // Create all the keys in the concurrent set
-        K** udarray = new K*[numElements];
-        for (int i = 0; i < numElements; i++) udarray[i] = new K(i);
-        // Add all the items to the list
-        set->addAll(udarray, numElements);
-
-        // Can either be a Reader or a Writer
-        auto rw_lambda = [this,&quit,&startFlag,&set,&udarray,&numElements](const int updateRatio, long long *ops, const int tid) {
-            long long numOps = 0;
+        auto rw_lambda = [&quit,&startFlag,&keyDist,&op](const int updateRatio, RunCounts* counts, const int tid) {
+            RunCounts local;
             while (!startFlag.load()) ; // spin
             uint64_t seed = tid+1234567890123456781ULL;
-            while (!quit.load()) {
-                seed = randomLong(seed);
-                int update = seed%1000;
-                seed = randomLong(seed);
-                auto ix = (unsigned int)(seed%numElements);
-                if (update < updateRatio) {
-                    // I'm a Writer
-                    if (set->remove(*udarray[ix])) {
-                    	numOps++;
-                    	set->add(*udarray[ix]);
-                    }
-                    numOps++;
-                } else {
-                	// I'm a Reader
-                    set->contains(*udarray[ix]);
-                    seed = randomLong(seed);
-                    ix = (unsigned int)(seed%numElements);
-                    set->contains(*udarray[ix]);
-                    numOps += 2;
-                }
-            }
-            *ops = numOps;
+            const KeyDistribution dist = keyDist;  // Thread-local copy
+            while (!quit.load()) op(tid, updateRatio, seed, dist, local);
+            *counts = local;
         };
 
         for (int irun = 0; irun < numRuns; irun++) {
+            std::vector<RunCounts> counts(numThreads);
             thread rwThreads[numThreads];
-            if (dedicated) {
-                rwThreads[0] = thread(rw_lambda, 1000, &ops[0][irun], 0);
-                rwThreads[1] = thread(rw_lambda, 1000, &ops[1][irun], 1);
-                for (int tid = 2; tid < numThreads; tid++) rwThreads[tid] = thread(rw_lambda, updateRatio, &ops[tid][irun], tid);
-            } else {
-                for (int tid = 0; tid < numThreads; tid++) rwThreads[tid] = thread(rw_lambda, updateRatio, &ops[tid][irun], tid);
+            for (int tid = 0; tid < numThreads; tid++) {
+                rwThreads[tid] = thread(rw_lambda, (dedicated && tid < 2) ? 1000 : updateRatio, &counts[tid], tid);
             }
             this_thread::sleep_for(100ms);
-            auto startBeats = steady_clock::now();
+            runStart = steady_clock::now();
             startFlag.store(true);
+            if (sampler != nullptr) sampler->start(className, updateRatio, numThreads, firstRun+irun);
             // Sleep for testLengthSeconds seconds
             this_thread::sleep_for(testLengthSeconds);
             quit.store(true);
             auto stopBeats = steady_clock::now();
             for (int tid = 0; tid < numThreads; tid++) rwThreads[tid].join();
-            lengthSec[irun] = (stopBeats-startBeats).count();
+            if (sampler != nullptr) sampler->stop();
+            quit.store(false);
+            startFlag.store(false);
+            const long long lengthNs = (stopBeats-runStart).count();
             if (dedicated) {
                 // We don't account for the write-only operations but we aggregate the values from the two threads and display them
-                std::cout << "Mutative transactions per second = " << (ops[0][irun] + ops[1][irun])*1000000000LL/lengthSec[irun] << "\n";
-                ops[0][irun] = 0;
-                ops[1][irun] = 0;
+                std::cout << "Mutative transactions per second = " << (counts[0].ops + counts[1].ops)*NSEC_IN_SEC/lengthNs << "\n";
+                counts[0] = counts[1] = RunCounts{};
             }
-            quit.store(false);
-            startFlag.store(false);
-            // Compute ops at the end of each run
-            long long agg = 0;
-            for (int tid = 0; tid < numThreads; tid++) {
-                agg += ops[tid][irun]*1000000000LL/lengthSec[irun];
+            for (auto& c : counts) {
+                perSec[irun].ops += c.ops*NSEC_IN_SEC/lengthNs;
+                perSec[irun].keys += c.keys*NSEC_IN_SEC/lengthNs;
             }
         }
+        return perSec;
+    }
+
+    // Prints the median of the ops/sec of all the runs, with the min and max, and returns it. numRuns must be an odd number
+    long long printMedianOps(const std::vector<RunCounts>& perSec) {
+        vector<long long> agg;
+        for (auto& c : perSec) agg.push_back(c.ops);
+        sort(agg.begin(),agg.end());
+        auto maxops = agg[agg.size()-1];
+        auto minops = agg[0];
+        auto medianops = agg[agg.size()/2];
+        auto delta = (long)(100.*(maxops-minops) / ((double)medianops));
+        // Printed value is the median of the number of ops per second that all threads were able to accomplish (on average)
+        std::cout << "Ops/sec = " << medianops << "      delta = " << delta << "%   min = " << minops << "   max = " << maxops << "\n";
+        return medianops;
+    }
+
+    // Adds the latencies of all the threads to the LatencyTable (with --latency)
+    void addLatency(const std::string& className, const int updateRatio, const std::vector<LatencyHistogram>& hists) {
+        if (latency == nullptr) return;
+        LatencyHistogram latencyAll;
+        for (auto& hist : hists) latencyAll.merge(hist);
+        latency->add(className, updateRatio, numThreads, latencyAll);
+    }
+
+    /**
+     * The operation of benchmark() and benchmarkRandomFill(), which can either be a Reader or a Writer.
+     * When 'hists' is not empty, each remove(), add() and contains() is timed into hists[tid].
+     */
+    template<typename S, typename K>
+    auto setOp(S* set, K** udarray, std::vector<LatencyHistogram>& hists) {
+        return [this,set,udarray,&hists](const int tid, const int updateRatio, uint64_t& seed, const KeyDistribution& dist, RunCounts& c) {
+            LatencyHistogram* hist = hists.empty() ? nullptr : &hists[tid];
+            steady_clock::time_point t;
+            seed = randomLong(seed);
+            int update = seed%1000;
+            auto ix = dist.next(seed);
+            if (hist != nullptr) t = steady_clock::now();
+            if (update < updateRatio) {
+                // I'm a Writer
+                if (set->remove(*udarray[ix])) {
+                    c.ops++;
+                    if (hist != nullptr) t = hist->recordSince(t);
+                    set->add(*udarray[ix]);
+                }
+                if (hist != nullptr) hist->recordSince(t);
+                c.ops++;
+            } else {
+                // I'm a Reader
+                set->contains(*udarray[ix]);
+                if (hist != nullptr) t = hist->recordSince(t);
+                ix = dist.next(seed);
+                set->contains(*udarray[ix]);
+                if (hist != nullptr) hist->recordSince(t);
+                c.ops += 2;
+            }
+        };
+    }
+
+public:
+    BenchmarkSets(int numThreads, MemorySampler* sampler=nullptr, LatencyTable* latency=nullptr) {
+        this->numThreads = numThreads;
+        this->sampler = sampler;
+        this->latency = (latency != nullptr && latency->enabled()) ? latency : nullptr;
+    }
+
+    // Distribution of the keys picked by the threads of all the benchmarks, for example "zipf:0.99"
+    void setKeyDistribution(const std::string& spec) {
+        keyDistribution = spec;
+    }
+
+    // Fill the sets with addAll() instead of one add() per key (--bulk)
+    void setBulkLoad(const bool enabled) {
+        bulk = enabled;
+    }
+
+    // From now on, benchmark() and benchmarkRandomFill() run benchmarkOpenLoop() for each of the 'rates', and add the results to 'table'
+    void openLoop(const std::vector<long long>& rates, LatencyTable* table) {
+        targetRates = rates;
+        openLoopTable = table;
+    }
+
+
+    /**
+     * When doing "updates" we execute a random removal and if the removal is successful we do an add() of the
+     * same item immediately after. This keeps the size of the data structure equal to the original size (minus
+     * MAX_THREADS items at most) which gives more deterministic results.
+     * With a LatencyTable, each remove(), add() and contains() is timed with steady_clock, which lowers
+     * the throughput, and the percentiles of all the runs are added to the table.
+     */
+    template<typename S, typename K>
+    long long benchmark(std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numRuns, const int numElements, const bool dedicated=false) {
+        if (!targetRates.empty()) return benchmarkOpenLoop<S,K>(className, updateRatio, testLengthSeconds, numElements);
+        className = S::className();
+        std::cout << "##### " << S::className() << " #####  \n";
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+        printNodeSize<S>(0);
+        S* set = new S();
+        // Create all the keys in the concurrent set
+        K** udarray = new K*[numElements];
+        for (int i = 0; i < numElements; i++) udarray[i] = new K(i);
+        // Add all the items to the list
+        fill(set, udarray, numElements);
+        std::vector<LatencyHistogram> hists((latency != nullptr) ? numThreads : 0);
+
+        const KeyDistribution keyDist {keyDistribution, (uint64_t)numElements};
+        auto perSec = runThreads(className, updateRatio, testLengthSeconds, numRuns, keyDist, setOp(set, udarray, hists), dedicated);
 
         // Clear the set, one key at a time and then delete the instance
         for (int i = 0; i < numElements; i++) set->remove(*udarray[i]);
@@ -229,22 +357,207 @@ public:
         for (int i = 0; i < numElements; i++) delete udarray[i];
         delete[] udarray;
 
-        // Accounting
-        vector<long long> agg(numRuns);
-        for (int irun = 0; irun < numRuns; irun++) {
-            for (int tid = 0; tid < numThreads; tid++) {
-                agg[irun] += ops[tid][irun]*1000000000LL/lengthSec[irun];
+        auto medianops = printMedianOps(perSec);
+        printOrcStats(orcStatsBefore);
+        addLatency(className, updateRatio, hists);
+        return medianops;
+    }
+
+
+    /**
+     * Open-loop version of benchmark() and benchmarkRandomFill(), which runs instead of them after openLoop() is called (--rates).
+     * With 'randomFill', half of the keys are added in random order before the others, like in benchmarkRandomFill().
+     * For each target rate (ops/sec of all the threads together) each thread issues one operation every
+     * numThreads/rate seconds on a fixed schedule, even if the previous one was late.
+     * The latency is measured from the time at which each operation was scheduled, therefore a thread that is
+     * stalled (in a long retire() for example) gets the delay added to all the operations it should have
+     * issued meanwhile, instead of hiding it like in the closed-loop benchmark (coordinated omission).
+     * A write is a remove() followed by an add() if the key was removed, and a read is a contains().
+     * The threads spin while waiting for the next scheduled time, so there should be one core per thread.
+     * Prints the saturation knee, the highest target rate for which at least 95% of it was achieved,
+     * and returns the throughput achieved at the last rate.
+     */
+    template<typename S, typename K>
+    long long benchmarkOpenLoop(std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numElements, const bool randomFill=false) {
+        long long nsInterval = 0;
+
+        className = S::className();
+        std::cout << "##### " << S::className() << " (open-loop) #####  \n";
+        printNodeSize<S>(0);
+        S* set = new S();
+        // Create all the keys in the concurrent set
+        K** udarray = new K*[numElements];
+        for (int i = 0; i < numElements; i++) udarray[i] = new K(i);
+        // Add all the items to the list
+        fill(set, udarray, numElements, randomFill);
+        std::vector<LatencyHistogram> hists(numThreads);
+        const KeyDistribution keyDist {keyDistribution, (uint64_t)numElements};
+
+        auto ol_op = [this,set,udarray,&nsInterval,&hists](const int tid, const int updateRatio, uint64_t& seed, const KeyDistribution& dist, RunCounts& c) {
+            // The threads are spread evenly over the interval, so that they don't all start their operations together
+            const auto scheduled = runStart + nanoseconds(nsInterval*tid/numThreads + nsInterval*c.ops);
+            if (steady_clock::now() < scheduled) return;  // spin until it is time for the next operation
+            seed = randomLong(seed);
+            int update = seed%1000;
+            auto ix = dist.next(seed);
+            if (update < updateRatio) {
+                // I'm a Writer
+                if (set->remove(*udarray[ix])) set->add(*udarray[ix]);
+            } else {
+                // I'm a Reader
+                set->contains(*udarray[ix]);
             }
+            hists[tid].recordSince(scheduled);
+            c.ops++;
+        };
+
+        const std::string label = LatencyTable::label(className, updateRatio) + "-" + std::to_string(numThreads) + "t";
+        long long achieved = 0;
+        long long knee = 0;
+        for (unsigned irate = 0; irate < targetRates.size(); irate++) {
+            const long long rate = targetRates[irate];
+            nsInterval = NSEC_IN_SEC*numThreads/rate;
+            for (auto& hist : hists) hist.reset();
+            achieved = runThreads(className, updateRatio, testLengthSeconds, 1, keyDist, ol_op, false, irate)[0].ops;
+            LatencyHistogram merged;
+            for (auto& hist : hists) merged.merge(hist);
+            std::cout << "Target ops/sec = " << rate << "   Achieved ops/sec = " << achieved << "\n";
+            if (openLoopTable != nullptr) openLoopTable->add(label, rate, merged, achieved);
+            if (achieved*100 >= rate*95) knee = std::max(knee, rate);
         }
+        std::cout << "Saturation knee = " << knee << " ops/sec\n";
 
-        // Compute the median. numRuns must be an odd number
-        sort(agg.begin(),agg.end());
-        auto maxops = agg[numRuns-1];
-        auto minops = agg[0];
-        auto medianops = agg[numRuns/2];
-        auto delta = (long)(100.*(maxops-minops) / ((double)medianops));
-        // Printed value is the median of the number of ops per second that all threads were able to accomplish (on average)
-        std::cout << "Ops/sec = " << medianops << "      delta = " << delta << "%   min = " << minops << "   max = " << maxops << "\n";
+        // Clear the set, one key at a time and then delete the instance
+        for (int i = 0; i < numElements; i++) set->remove(*udarray[i]);
+        delete set;
+
+        for (int i = 0; i < numElements; i++) delete udarray[i];
+        delete[] udarray;
+        return achieved;
+    }
+
+
+
+    /**
+     * Same as benchmark() but the readers do an ordered scan with range() over 'scanLength' consecutive keys,
+     * starting at a random key, instead of two contains(). Each scan counts as one operation, and the
+     * median number of keys visited per second by all the scans is printed as well.
+     * Only for the sets that have range(lo,hi,callback), returning the number of keys visited.
+     */
+    template<typename S, typename K>
+    long long benchmarkScans(std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numRuns, const int numElements, const int scanLength=100) {
+        className = S::className() + "-Scan" + std::to_string(scanLength);
+        std::cout << "##### " << className << " #####  \n";
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+        printNodeSize<S>(0);
+        S* set = new S();
+        // Create all the keys in the concurrent set
+        K** udarray = new K*[numElements];
+        for (int i = 0; i < numElements; i++) udarray[i] = new K(i);
+        // Add all the items in random order, otherwise the (unbalanced) trees degenerate into a list
+        K** shuffled = new K*[numElements];
+        for (int i = 0; i < numElements; i++) shuffled[i] = udarray[i];
+        uint64_t fillSeed = 1234567890123456781ULL;
+        for (int i = numElements-1; i > 0; i--) {
+            fillSeed = randomLong(fillSeed);
+            std::swap(shuffled[i], shuffled[fillSeed%(i+1)]);
+        }
+        set->addAll(shuffled, numElements);
+        delete[] shuffled;
+        // The first scan must see all the keys, including with a snapshot after a bulk load
+        if (numElements > 0 && set->range(*udarray[0], *udarray[numElements-1], [](const K&){}) != numElements) {
+            cout << "ERROR: the first scan after addAll() did not see all the keys\n";
+        }
+
+        const KeyDistribution keyDist {keyDistribution, (uint64_t)numElements};
+
+        // Can either be a Scanner or a Writer
+        auto scan_op = [this,set,udarray,numElements,scanLength](const int, const int updateRatio, uint64_t& seed, const KeyDistribution& dist, RunCounts& c) {
+            seed = randomLong(seed);
+            int update = seed%1000;
+            auto ix = dist.next(seed);
+            if (update < updateRatio) {
+                // I'm a Writer
+                if (set->remove(*udarray[ix])) {
+                    c.ops++;
+                    set->add(*udarray[ix]);
+                }
+                c.ops++;
+            } else {
+                // I'm a Scanner
+                auto ixhi = std::min(ix + scanLength - 1, (unsigned int)numElements - 1);
+                c.keys += set->range(*udarray[ix], *udarray[ixhi], [](const K&){});
+                c.ops++;
+            }
+        };
+        auto perSec = runThreads(className, updateRatio, testLengthSeconds, numRuns, keyDist, scan_op);
+
+        // Clear the set, one key at a time and then delete the instance
+        for (int i = 0; i < numElements; i++) set->remove(*udarray[i]);
+        delete set;
+
+        for (int i = 0; i < numElements; i++) delete udarray[i];
+        delete[] udarray;
+
+        vector<long long> aggKeys;
+        for (auto& c : perSec) aggKeys.push_back(c.keys);
+        sort(aggKeys.begin(),aggKeys.end());
+        std::cout << "Keys scanned/sec = " << aggKeys[numRuns/2] << "\n";
+        auto medianops = printMedianOps(perSec);
+        printOrcStats(orcStatsBefore);
+        return medianops;
+    }
+
+
+
+    /**
+     * Same as benchmark() but for maps, where an "update" is a put() of a new value on an existing key,
+     * which swaps the value in place instead of doing a remove() followed by an add().
+     * Reads are done with get(). The size of the map does not change during the run.
+     */
+    template<typename S, typename K>
+    long long benchmarkMapPut(std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numRuns, const int numElements, const bool dedicated=false) {
+        className = S::className();
+        std::cout << "##### " << S::className() << " #####  \n";
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+        printNodeSize<S>(0);
+        S* set = new S();
+        // Create all the keys in the concurrent set
+        K** udarray = new K*[numElements];
+        for (int i = 0; i < numElements; i++) udarray[i] = new K(i);
+        // Add all the items to the list
+        fill(set, udarray, numElements);
+
+        const KeyDistribution keyDist {keyDistribution, (uint64_t)numElements};
+
+        // Can either be a Reader or a Writer
+        auto put_op = [this,set,udarray](const int, const int updateRatio, uint64_t& seed, const KeyDistribution& dist, RunCounts& c) {
+            seed = randomLong(seed);
+            int update = seed%1000;
+            auto ix = dist.next(seed);
+            if (update < updateRatio) {
+                // I'm a Writer
+                set->put(*udarray[ix], *udarray[ix]);
+                c.ops++;
+            } else {
+                // I'm a Reader
+                set->get(*udarray[ix]);
+                ix = dist.next(seed);
+                set->get(*udarray[ix]);
+                c.ops += 2;
+            }
+        };
+        auto perSec = runThreads(className, updateRatio, testLengthSeconds, numRuns, keyDist, put_op, dedicated);
+
+        // Clear the set, one key at a time and then delete the instance
+        for (int i = 0; i < numElements; i++) set->remove(*udarray[i]);
+        delete set;
+
+        for (int i = 0; i < numElements; i++) delete udarray[i];
+        delete[] udarray;
+
+        auto medianops = printMedianOps(perSec);
+        printOrcStats(orcStatsBefore);
         return medianops;
     }
 
@@ -252,92 +565,25 @@ public:
 
     /*
      * Inspired by Trevor Brown's benchmarks (does everyone else do it like this?)
+     * With a LatencyTable, the operations are timed like in benchmark().
      */
     template<typename S, typename K>
     long long benchmarkRandomFill(std::string& className, const int updateRatio, const seconds testLengthSeconds, const int numRuns, const int numElements, const bool dedicated=false) {
-        long long ops[numThreads][numRuns];
-        long long lengthSec[numRuns];
-        atomic<bool> quit = { false };
-        atomic<bool> startFlag = { false };
-
+        if (!targetRates.empty()) return benchmarkOpenLoop<S,K>(className, updateRatio, testLengthSeconds, numElements, true);
         className = S::className();
         std::cout << "##### " << S::className() << " #####  \n";
+        const auto orcStatsBefore = orcgc_ptp::g_ptp.getStats();
+        printNodeSize<S>(0);
         S* set = new S();
         // Create all the keys in the concurrent set
         K** udarray = new K*[2*numElements];
         for (int i = 0; i < 2*numElements; i++) udarray[i] = new K(i);
-        // Add half the keys to the list
-        long ielem = 0;
-        uint64_t seed = 1234567890123456781ULL;
-        while (ielem < numElements/2) {
-            seed = randomLong(seed);
-            // Insert new random keys until we have 'numElements/2' keys in the tree
-            if (set->add(*udarray[seed%(numElements)])) ielem++;
-        }
-        // Add all keys, repeating if needed
-        set->addAll(udarray, numElements);
+        // Add half the keys in random order and then all keys, repeating if needed
+        fill(set, udarray, numElements, true);
+        std::vector<LatencyHistogram> hists((latency != nullptr) ? numThreads : 0);
 
-        // Can either be a Reader or a Writer
-        auto rw_lambda = [this,&quit,&startFlag,&set,&udarray,&numElements](const int updateRatio, long long *ops, const int tid) {
-            long long numOps = 0;
-            while (!startFlag.load()) ; // spin
-            uint64_t seed = tid+1234567890123456781ULL;
-            while (!quit.load()) {
-                seed = randomLong(seed);
-                int update = seed%1000;
-                seed = randomLong(seed);
-                auto ix = (unsigned int)(seed%numElements);
-                if (update < updateRatio) {
-                    // I'm a Writer
-                    if (set->remove(*udarray[ix])) {
-                        numOps++;
-                        set->add(*udarray[ix]);
-                    }
-                    numOps++;
-                } else {
-                    // I'm a Reader
-                    set->contains(*udarray[ix]);
-                    seed = randomLong(seed);
-                    ix = (unsigned int)(seed%numElements);
-                    set->contains(*udarray[ix]);
-                    numOps += 2;
-                }
-            }
-            *ops = numOps;
-        };
-
-        for (int irun = 0; irun < numRuns; irun++) {
-            thread rwThreads[numThreads];
-            if (dedicated) {
-                rwThreads[0] = thread(rw_lambda, 1000, &ops[0][irun], 0);
-                rwThreads[1] = thread(rw_lambda, 1000, &ops[1][irun], 1);
-                for (int tid = 2; tid < numThreads; tid++) rwThreads[tid] = thread(rw_lambda, updateRatio, &ops[tid][irun], tid);
-            } else {
-                for (int tid = 0; tid < numThreads; tid++) rwThreads[tid] = thread(rw_lambda, updateRatio, &ops[tid][irun], tid);
-            }
-            this_thread::sleep_for(100ms);
-            auto startBeats = steady_clock::now();
-            startFlag.store(true);
-            // Sleep for testLengthSeconds seconds
-            this_thread::sleep_for(testLengthSeconds);
-            quit.store(true);
-            auto stopBeats = steady_clock::now();
-            for (int tid = 0; tid < numThreads; tid++) rwThreads[tid].join();
-            lengthSec[irun] = (stopBeats-startBeats).count();
-            if (dedicated) {
-                // We don't account for the write-only operations but we aggregate the values from the two threads and display them
-                std::cout << "Mutative transactions per second = " << (ops[0][irun] + ops[1][irun])*1000000000LL/lengthSec[irun] << "\n";
-                ops[0][irun] = 0;
-                ops[1][irun] = 0;
-            }
-            quit.store(false);
-            startFlag.store(false);
-            // Compute ops at the end of each run
-            long long agg = 0;
-            for (int tid = 0; tid < numThreads; tid++) {
-                agg += ops[tid][irun]*1000000000LL/lengthSec[irun];
-            }
-        }
+        const KeyDistribution keyDist {keyDistribution, (uint64_t)numElements};
+        auto perSec = runThreads(className, updateRatio, testLengthSeconds, numRuns, keyDist, setOp(set, udarray, hists), dedicated);
 
         /* Clear the tree, one key at a time and then delete the instance */
         for (int i = 0; i < numElements; i++) set->remove(*udarray[i]);
@@ -346,22 +592,9 @@ public:
         for (int i = 0; i < numElements*2; i++) delete udarray[i];
         delete[] udarray;
 
-        // Accounting
-        vector<long long> agg(numRuns);
-        for (int irun = 0; irun < numRuns; irun++) {
-            for (int tid = 0; tid < numThreads; tid++) {
-                agg[irun] += ops[tid][irun]*1000000000LL/lengthSec[irun];
-            }
-        }
-
-        // Compute the median. numRuns must be an odd number
-        sort(agg.begin(),agg.end());
-        auto maxops = agg[numRuns-1];
-        auto minops = agg[0];
-        auto medianops = agg[numRuns/2];
-        auto delta = (long)(100.*(maxops-minops) / ((double)medianops));
-        // Printed value is the median of the number of ops per second that all threads were able to accomplish (on average)
-        std::cout << "Ops/sec = " << medianops << "      delta = " << delta << "%   min = " << minops << "   max = " << maxops << "\n";
+        auto medianops = printMedianOps(perSec);
+        printOrcStats(orcStatsBefore);
+        addLatency(className, updateRatio, hists);
         return medianops;
     }
 
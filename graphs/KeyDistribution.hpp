@@ -0,0 +1,145 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#ifndef _KEY_DISTRIBUTION_H_
+#define _KEY_DISTRIBUTION_H_
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+
+/**
+ * Distribution of the keys picked by the threads of BenchmarkSets, selected with --dist=
+ *
+ * uniform         All the keys have the same probability. This is the default and gives the same keys as before.
+ * zipf:θ          Zipfian with exponent 0 < θ < 1 (0.99 if omitted), where key rank i has a probability
+ *                 proportional to 1/(i+1)^θ. Uses the method of Gray et al. ("Quickly generating billion-record
+ *                 synthetic databases", also used by YCSB): zeta(n,θ) is computed once in the constructor,
+ *                 and each key costs one pow().
+ * hotspot:p,q     A fraction p of the operations goes to a fraction q of the keys (e.g. hotspot:0.9,0.01),
+ *                 uniformly within the hot keys and within the cold ones.
+ *
+ * For zipf and hotspot, the ranks are spread over the key space with (rank * PRIME) % n, which is a
+ * permutation because PRIME is larger than n, so that the hot keys are not all at the start of a list
+ * or in the same subtree.
+ * The object is read-only after construction. Each thread keeps its own copy and its own seed.
+ */
+class KeyDistribution {
+
+public:
+    enum Type { UNIFORM, ZIPF, HOTSPOT };
+
+private:
+    static const uint64_t PRIME = 2654435761ULL;
+
+    Type     type {UNIFORM};
+    uint64_t n;
+    double   theta {0.99};
+    double   hotOps {0.0};      // p in hotspot:p,q
+    uint64_t hotKeys {1};       // q*n in hotspot:p,q
+    // Zipf constants
+    double   zetan {0.0};
+    double   alpha {0.0};
+    double   eta {0.0};
+    double   halfPowTheta {0.0};
+
+    // Same generator as BenchmarkSets::randomLong()
+    static inline uint64_t randomLong(uint64_t x) {
+        x ^= x >> 12; // a
+        x ^= x << 25; // b
+        x ^= x >> 27; // c
+        return x * 2685821657736338717LL;
+    }
+
+    // Uniform in [0,1)
+    static inline double randomDouble(uint64_t& seed) {
+        seed = randomLong(seed);
+        return (seed >> 11) * (1.0 / (1ULL << 53));
+    }
+
+    // Returns false if 'spec' is not valid
+    static bool parse(const std::string& spec, Type& type, double& a, double& b) {
+        if (spec == "uniform") {
+            type = UNIFORM;
+            return true;
+        }
+        if (spec == "zipf" || spec.compare(0, 5, "zipf:") == 0) {
+            type = ZIPF;
+            a = (spec == "zipf") ? 0.99 : std::atof(spec.c_str()+5);
+            return a > 0.0 && a < 1.0;
+        }
+        if (spec.compare(0, 8, "hotspot:") == 0) {
+            type = HOTSPOT;
+            const auto comma = spec.find(',');
+            if (comma == std::string::npos) return false;
+            a = std::atof(spec.c_str()+8);
+            b = std::atof(spec.c_str()+comma+1);
+            return a >= 0.0 && a <= 1.0 && b > 0.0 && b <= 1.0;
+        }
+        return false;
+    }
+
+    inline uint64_t scatter(const uint64_t rank) const { return (rank * PRIME) % n; }
+
+public:
+    KeyDistribution(const std::string& spec, const uint64_t numElements) : n{numElements} {
+        double a = 0, b = 0;
+        if (!parse(spec, type, a, b)) {
+            std::cout << "ERROR: invalid key distribution '" << spec << "', using uniform\n";
+            type = UNIFORM;
+        }
+        if (type == ZIPF) {
+            theta = a;
+            for (uint64_t i = 1; i <= n; i++) zetan += 1.0 / std::pow((double)i, theta);
+            const double zeta2 = 1.0 + std::pow(0.5, theta);
+            alpha = 1.0 / (1.0 - theta);
+            eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+            halfPowTheta = std::pow(0.5, theta);
+        } else if (type == HOTSPOT) {
+            hotOps = a;
+            hotKeys = std::max<uint64_t>(1, (uint64_t)(b * n));
+        }
+    }
+
+    // Suffix for the data files, or an empty string for uniform (and invalid) distributions
+    static std::string fileSuffix(const std::string& spec) {
+        Type type;
+        double a = 0, b = 0;
+        if (!parse(spec, type, a, b) || type == UNIFORM) return "";
+        std::ostringstream os;
+        if (type == ZIPF) os << "-zipf" << a;
+        else os << "-hotspot" << a << "-" << b;
+        return os.str();
+    }
+
+    // Advances 'seed' and returns an index in [0,n)
+    inline unsigned int next(uint64_t& seed) const {
+        if (type == UNIFORM) {
+            seed = randomLong(seed);
+            return (unsigned int)(seed % n);
+        }
+        if (type == HOTSPOT) {
+            const bool hot = randomDouble(seed) < hotOps || hotKeys == n;
+            seed = randomLong(seed);
+            return (unsigned int)scatter(hot ? seed % hotKeys : hotKeys + seed % (n - hotKeys));
+        }
+        const double u = randomDouble(seed);
+        const double uz = u * zetan;
+        if (uz < 1.0) return (unsigned int)scatter(0);
+        if (uz < 1.0 + halfPowTheta) return (unsigned int)scatter(1);
+        const uint64_t rank = (uint64_t)(n * std::pow(eta * u - eta + 1.0, alpha));
+        return (unsigned int)scatter(rank < n ? rank : n - 1);
+    }
+};
+
+#endif
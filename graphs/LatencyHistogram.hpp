@@ -0,0 +1,188 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#ifndef _LATENCY_HISTOGRAM_H_
+#define _LATENCY_HISTOGRAM_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+/**
+ * Histogram of latencies in nanoseconds, with the same log-linear buckets as HdrHistogram:
+ * the values below SUB_BUCKETS have their own bucket, and each power of two above that is split
+ * into SUB_BUCKETS buckets of equal width, therefore a percentile is never off by more than
+ * 1/SUB_BUCKETS (about 3%) of its value.
+ * Each thread records into its own histogram, and the histograms are merged after the run.
+ */
+class alignas(128) LatencyHistogram {
+
+private:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total {0};
+    uint64_t maxValue {0};
+
+    static inline int bucketIndex(const uint64_t value) {
+        if (value < SUB_BUCKETS) return (int)value;
+        const int msb = 63 - __builtin_clzll(value);
+        const int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + (int)((value >> shift) - SUB_BUCKETS);
+    }
+
+    // Largest value that falls in the bucket
+    static inline uint64_t bucketValue(const int idx) {
+        if (idx < SUB_BUCKETS) return idx;
+        const int shift = idx / SUB_BUCKETS - 1;
+        const uint64_t lowest = (uint64_t)(SUB_BUCKETS + idx % SUB_BUCKETS) << shift;
+        return lowest + (1ULL << shift) - 1;
+    }
+
+public:
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        std::memset(counts, 0, sizeof(counts));
+        total = 0;
+        maxValue = 0;
+    }
+
+    inline void record(const uint64_t nanos) {
+        counts[bucketIndex(nanos)]++;
+        total++;
+        if (nanos > maxValue) maxValue = nanos;
+    }
+
+    // Records the time elapsed since 'start' and returns the current time, to be the start of the next operation
+    inline std::chrono::steady_clock::time_point recordSince(const std::chrono::steady_clock::time_point start) {
+        const auto now = std::chrono::steady_clock::now();
+        record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+        return now;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < NUM_BUCKETS; i++) counts[i] += other.counts[i];
+        total += other.total;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    uint64_t count() const { return total; }
+
+    uint64_t max() const { return maxValue; }
+
+    // Value (in ns) below or at which 'percent' of the recorded values are
+    uint64_t percentile(const double percent) const {
+        if (total == 0) return 0;
+        uint64_t target = (uint64_t)(percent/100. * total + 0.5);
+        if (target == 0) target = 1;
+        uint64_t sum = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            sum += counts[i];
+            if (sum >= target) return std::min(bucketValue(i), maxValue);
+        }
+        return maxValue;
+    }
+};
+
+
+/**
+ * Percentiles of each data structure, for each number of threads, written with the same layout as
+ * the throughput files: one row per number of threads, and one column per class, ratio and percentile.
+ * Enabled with --latency, in which case the benchmarks time each operation and add() their merged histogram.
+ * The open-loop benchmark uses its own table, with one row per target rate instead of per number of threads,
+ * and the achieved throughput in the first column of each class.
+ */
+class LatencyTable {
+
+private:
+    static const int NUM_PERCENTILES = 6;
+    const double     percentiles[NUM_PERCENTILES] = { 50., 90., 99., 99.9, 99.99, 100. };
+    const char*      percentileNames[NUM_PERCENTILES] = { "p50", "p90", "p99", "p99.9", "p99.99", "max" };
+
+    struct Entry {
+        std::string label;
+        long long   row;
+        long long   opsPerSec;
+        uint64_t    values[NUM_PERCENTILES];
+    };
+
+    const std::string        filename;
+    const bool               isEnabled;
+    const std::string        rowName;
+    const bool               withThroughput;
+    std::vector<std::string> labels;    // Columns, in the order they were added
+    std::vector<long long>   rows;      // Rows, in the order they were added
+    std::vector<Entry>       entries;
+
+public:
+    LatencyTable(const std::string& filename, const bool enabled, const std::string& rowName="Threads", const bool withThroughput=false)
+        : filename{filename}, isEnabled{enabled}, rowName{rowName}, withThroughput{withThroughput} { }
+
+    bool enabled() const { return isEnabled; }
+
+    // Name of the column in the throughput file. 'ratio' is in permil (-1 for none)
+    static std::string label(const std::string& className, const int ratio) {
+        std::ostringstream os;
+        os << className;
+        if (ratio >= 0) os << "-" << ratio/10. << "%";
+        return os.str();
+    }
+
+    void add(const std::string& className, const int ratio, const int numThreads, const LatencyHistogram& hist) {
+        add(label(className, ratio), numThreads, hist);
+    }
+
+    void add(const std::string& label, const long long row, const LatencyHistogram& hist, const long long opsPerSec=0) {
+        Entry e {label, row, opsPerSec, {}};
+        std::cout << "Latency (ns):";
+        for (int ip = 0; ip < NUM_PERCENTILES; ip++) {
+            e.values[ip] = (percentiles[ip] == 100.) ? hist.max() : hist.percentile(percentiles[ip]);
+            std::cout << " " << percentileNames[ip] << "=" << e.values[ip];
+        }
+        std::cout << "   samples=" << hist.count() << "\n";
+        if (std::find(labels.begin(), labels.end(), e.label) == labels.end()) labels.push_back(e.label);
+        if (std::find(rows.begin(), rows.end(), row) == rows.end()) rows.push_back(row);
+        entries.push_back(e);
+    }
+
+    // Export tab-separated values to a file to be imported in gnuplot or excel
+    void save() {
+        if (!isEnabled) return;
+        std::ofstream dataFile;
+        dataFile.open(filename);
+        dataFile << rowName << "\t";
+        for (auto& label : labels) {
+            if (withThroughput) dataFile << label << "-ops/s\t";
+            for (int ip = 0; ip < NUM_PERCENTILES; ip++) dataFile << label << "-" << percentileNames[ip] << "\t";
+        }
+        dataFile << "\n";
+        for (long long row : rows) {
+            dataFile << row << "\t";
+            for (auto& label : labels) {
+                auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry& e) { return e.label == label && e.row == row; });
+                if (withThroughput) dataFile << (it == entries.end() ? 0 : it->opsPerSec) << "\t";
+                for (int ip = 0; ip < NUM_PERCENTILES; ip++) dataFile << (it == entries.end() ? 0 : it->values[ip]) << "\t";
+            }
+            dataFile << "\n";
+        }
+        dataFile.close();
+        std::cout << "\nSuccessfuly saved latencies in " << filename << "\n";
+    }
+};
+
+#endif
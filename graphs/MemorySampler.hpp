@@ -0,0 +1,128 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#ifndef _MEMORY_SAMPLER_H_
+#define _MEMORY_SAMPLER_H_
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+
+#include "trackers/OrcPTP.hpp"
+
+
+/**
+ * Samples the memory usage while a benchmark runs and writes it as a time series (tab-separated values),
+ * next to the file with the throughput results. Enabled with --memsample=<period in ms>.
+ *
+ * Each row has the resident set size of the process, and the OrcGC gauges of the default domain (g_ptp):
+ * the objects held in the handovers and their bound, the objects in the recursive retire lists,
+ * and the live objects allocated with make_orc<T>(), in total and for each type.
+ * The data structures that have their own domain show up in the live objects, but not in the handovers.
+ *
+ * The benchmarks call start() when the threads start the measurements, and stop() after they have
+ * been joined, which takes a last sample and prints the maximums of the run.
+ */
+class MemorySampler {
+
+private:
+    const int                   periodMs;
+    std::ofstream               dataFile;
+    std::thread                 samplerThread;
+    std::atomic<bool>           quit {false};
+    std::string                 label;
+    int                         numThreads {0};
+    int                         run {0};
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t                    maxRSS {0};
+    uint64_t                    maxHandovers {0};
+    uint64_t                    maxBound {0};
+    int64_t                     maxLive {0};
+
+    // Resident set size of this process, in KB. Linux only
+    static uint64_t rssKB() {
+        long pages = 0;
+        std::ifstream statm("/proc/self/statm");
+        statm >> pages >> pages;  // The second value is the resident set size, in pages
+        return pages * (sysconf(_SC_PAGESIZE)/1024);
+    }
+
+    void sample() {
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+        const uint64_t rss = rssKB();
+        const auto gauge = orcgc_ptp::g_ptp.getGauge();
+        auto& live = orcgc_ptp::g_orc_live;
+        const int64_t totalLive = live.getTotalLive();
+        dataFile << label << "\t" << numThreads << "\t" << run << "\t" << ms << "\t" << rss << "\t";
+        dataFile << gauge.handovers << "\t" << gauge.bound << "\t" << gauge.recursive << "\t" << totalLive << "\t";
+        for (int i = 0; i < live.getNumTypes(); i++) {
+            const int64_t count = live.getLive(i);
+            const char* name = live.getTypeName(i);
+            if (count != 0 && name != nullptr) dataFile << name << "=" << count << ";";
+        }
+        dataFile << "\n";
+        maxRSS = std::max(maxRSS, rss);
+        maxHandovers = std::max(maxHandovers, gauge.handovers);
+        maxBound = std::max(maxBound, gauge.bound);
+        maxLive = std::max(maxLive, totalLive);
+    }
+
+public:
+    // If periodMs is zero, nothing is sampled and no file is created
+    MemorySampler(const std::string& filename, const int periodMs) : periodMs{periodMs} {
+        if (periodMs == 0) return;
+        dataFile.open(filename);
+        dataFile << "Class\tThreads\tRun\tTime(ms)\tRSS(KB)\tHandovers\tHandoverBound\tRecursive\tLive\tLivePerType\n";
+        std::cout << "Sampling the memory every " << periodMs << " ms into " << filename << "\n";
+    }
+
+    ~MemorySampler() {
+        if (samplerThread.joinable()) stop();
+    }
+
+    bool enabled() const { return periodMs != 0; }
+
+    // 'className' is the name of the column in the throughput file, and 'ratio' is in permil (-1 for none)
+    void start(const std::string& className, const int ratio, const int nThreads, const int irun) {
+        if (periodMs == 0) return;
+        std::ostringstream os;
+        os << className;
+        if (ratio >= 0) os << "-" << ratio/10. << "%";
+        label = os.str();
+        numThreads = nThreads;
+        run = irun;
+        maxRSS = maxHandovers = maxBound = 0;
+        maxLive = 0;
+        startTime = std::chrono::steady_clock::now();
+        quit.store(false);
+        samplerThread = std::thread([this] () {
+            while (!quit.load()) {
+                sample();
+                std::this_thread::sleep_for(std::chrono::milliseconds(periodMs));
+            }
+        });
+    }
+
+    void stop() {
+        if (periodMs == 0) return;
+        quit.store(true);
+        samplerThread.join();
+        sample();
+        dataFile.flush();
+        std::cout << "Memory: max RSS = " << maxRSS << " KB   max live OrcGC objects = " << maxLive;
+        std::cout << "   max handovers = " << maxHandovers << " (bound " << maxBound << ")\n";
+    }
+};
+
+#endif
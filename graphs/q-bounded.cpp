@@ -0,0 +1,94 @@
+/*
+ * Executes the bounded queue (VyukovQueueOrcGC) and LCRQ in the enqueue-dequeue pairs, inbox and burst benchmarks:
+ */
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include "BenchmarkQueues.hpp"
+#include "common/CmdLineConfig.hpp"
+#include "datastructures/queues/LCRQueueOrcGC.hpp"
+#include "datastructures/queues/VyukovQueueOrcGC.hpp"
+
+
+#define MILLION  1000000LL
+
+// Small enough for the producers of the inbox benchmark to fill it up, and their rejected enqueues are retried and
+// reported. The burst benchmark needs room for a whole burst, therefore it uses a second queue sized to the burst.
+static const uint64_t kBoundedCapacity = 1024;
+static const uint64_t kBurstSize = MILLION;
+
+int main(int argc, char* argv[]) {
+    CmdLineConfig cfg;
+    cfg.parseCmdLine(argc,argv);
+    cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
+
+    const std::string dataFilename { "data/q-bounded.txt" };
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    // With --latency, the percentiles are saved into data/<benchmark>-latency.txt (see LatencyHistogram.hpp)
+    LatencyTable latencyTable { dataFilename.substr(0, dataFilename.size()-4) + "-latency.txt", cfg.latency };
+    const long numPairs = 10*MILLION;
+    const long long numItems = 10*MILLION;
+    const int numIters = 10;
+    const int EMAX_CLASS = 10;
+    uint64_t results[EMAX_CLASS][cfg.threads.size()];
+    std::string cNames[EMAX_CLASS];
+    int maxClass = 0;
+    // Reset results
+    std::memset(results, 0, sizeof(uint64_t)*EMAX_CLASS*cfg.threads.size());
+
+    for (int it = 0; it < cfg.threads.size(); it++) {
+        int nThreads = cfg.threads[it];
+        int ic = 0;
+        BenchmarkQueues bench(nThreads, &memSampler, &latencyTable);
+
+        // Enq-Deq Throughput benchmarks
+        std::cout << "\n----- q-bounded enq-deq   threads=" << nThreads << "   pairs=" << numPairs/MILLION << "M   runs=" << cfg.runs << " -----\n";
+        results[ic][it] = bench.enqDeq<VyukovQueueOrcGC<UserData,kBoundedCapacity>>     (cNames[ic], numPairs, cfg.runs);
+        ic++;
+        results[ic][it] = bench.enqDeq<LCRQueueOrcGC<UserData>>                         (cNames[ic], numPairs, cfg.runs);
+        ic++;
+
+        // Inbox benchmarks, where 'threads' is the number of producers
+        std::cout << "\n----- q-bounded inbox   producers=" << nThreads << "   items=" << numItems/MILLION << "M   runs=" << cfg.runs << " -----\n";
+        results[ic][it] = bench.inbox<VyukovQueueOrcGC<UserData,kBoundedCapacity>>      (cNames[ic], numItems, cfg.runs);
+        cNames[ic] += "-Inbox";
+        ic++;
+        results[ic][it] = bench.inbox<LCRQueueOrcGC<UserData>>                          (cNames[ic], numItems, cfg.runs);
+        cNames[ic] += "-Inbox";
+        ic++;
+
+        // Burst benchmarks
+        std::cout << "\n----- q-bounded burst   threads=" << nThreads << "   burst=" << kBurstSize/MILLION << "M   iters=" << numIters << "   runs=" << cfg.runs << " -----\n";
+        bench.burst<VyukovQueueOrcGC<UserData,kBurstSize>>(cNames[ic], results[ic][it], results[ic+1][it], kBurstSize, numIters, cfg.runs);
+        cNames[ic+1] = cNames[ic] + "-Deq";
+        cNames[ic] += "-Enq";
+        ic += 2;
+        bench.burst<LCRQueueOrcGC<UserData>>(cNames[ic], results[ic][it], results[ic+1][it], kBurstSize, numIters, cfg.runs);
+        cNames[ic+1] = cNames[ic] + "-Deq";
+        cNames[ic] += "-Enq";
+        ic += 2;
+
+        maxClass = ic;
+    }
+
+    // Export tab-separated values to a file to be imported in gnuplot or excel
+    ofstream dataFile;
+    dataFile.open(dataFilename);
+    dataFile << "Threads\t";
+    // Printf class names for each column
+    for (int ic = 0; ic < maxClass; ic++) dataFile << cNames[ic] << "\t";
+    dataFile << "\n";
+    for (int it = 0; it < cfg.threads.size(); it++) {
+        dataFile << cfg.threads[it] << "\t";
+        for (int ic = 0; ic < maxClass; ic++) dataFile << results[ic][it] << "\t";
+        dataFile << "\n";
+    }
+    dataFile.close();
+    std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+    latencyTable.save();
+
+    return 0;
+}
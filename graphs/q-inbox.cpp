@@ -0,0 +1,81 @@
+/*
+ * Executes the Michael-Scott queue with OrcGC and its single-producer/single-consumer variants
+ * in the inbox benchmark (many producers, one consumer) and in the single-consumer burst benchmark:
+ */
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include "BenchmarkQueues.hpp"
+#include "common/CmdLineConfig.hpp"
+#include "datastructures/queues/MichaelScottQueueOrcGC.hpp"
+
+
+#define MILLION  1000000LL
+
+int main(int argc, char* argv[]) {
+    CmdLineConfig cfg;
+    cfg.parseCmdLine(argc,argv);
+    cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
+
+    const std::string dataFilename { "data/q-inbox.txt" };
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    const long long numItems = 10*MILLION;
+    const long long burstSize = MILLION;
+    const int numIters = 10;
+    const int EMAX_CLASS = 10;
+    uint64_t results[EMAX_CLASS][cfg.threads.size()];
+    std::string cNames[EMAX_CLASS];
+    int maxClass = 0;
+    // Reset results
+    std::memset(results, 0, sizeof(uint64_t)*EMAX_CLASS*cfg.threads.size());
+
+    for (int it = 0; it < cfg.threads.size(); it++) {
+        int nThreads = cfg.threads[it];
+        int ic = 0;
+        BenchmarkQueues bench(nThreads, &memSampler);
+
+        // Inbox benchmarks, where 'threads' is the number of producers
+        std::cout << "\n----- q-inbox   producers=" << nThreads << "   items=" << numItems/MILLION << "M   runs=" << cfg.runs << " -----\n";
+        results[ic][it] = bench.inbox<MichaelScottQueueOrcGC<UserData>>                 (cNames[ic], numItems, cfg.runs);
+        ic++;
+        results[ic][it] = bench.inbox<MichaelScottQueueOrcGC<UserData,false,true>>      (cNames[ic], numItems, cfg.runs);
+        ic++;
+        // The single-producer queue can only be measured with one producer, its column is zero for the other rows
+        cNames[ic] = MichaelScottQueueOrcGC<UserData,true,true>::className();
+        if (nThreads == 1) results[ic][it] = bench.inbox<MichaelScottQueueOrcGC<UserData,true,true>>(cNames[ic], numItems, cfg.runs);
+        ic++;
+
+        // Burst benchmarks where only one of the threads dequeues
+        std::cout << "\n----- q-inbox burst   threads=" << nThreads << "   burst=" << burstSize/MILLION << "M   iters=" << numIters << "   runs=" << cfg.runs << " -----\n";
+        bench.burst<MichaelScottQueueOrcGC<UserData>>(cNames[ic], results[ic][it], results[ic+1][it], burstSize, numIters, cfg.runs, true);
+        cNames[ic+1] = cNames[ic] + "-Deq";
+        cNames[ic] += "-Enq";
+        ic += 2;
+        bench.burst<MichaelScottQueueOrcGC<UserData,false,true>>(cNames[ic], results[ic][it], results[ic+1][it], burstSize, numIters, cfg.runs, true);
+        cNames[ic+1] = cNames[ic] + "-Deq";
+        cNames[ic] += "-Enq";
+        ic += 2;
+
+        maxClass = ic;
+    }
+
+    // Export tab-separated values to a file to be imported in gnuplot or excel
+    ofstream dataFile;
+    dataFile.open(dataFilename);
+    dataFile << "Threads\t";
+    // Printf class names for each column
+    for (int ic = 0; ic < maxClass; ic++) dataFile << cNames[ic] << "\t";
+    dataFile << "\n";
+    for (int it = 0; it < cfg.threads.size(); it++) {
+        dataFile << cfg.threads[it] << "\t";
+        for (int ic = 0; ic < maxClass; ic++) dataFile << results[ic][it] << "\t";
+        dataFile << "\n";
+    }
+    dataFile.close();
+    std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include "datastructures/queues/KoganPetrankQueueOrcGC.hpp"
 #include "datastructures/queues/LCRQueue.hpp"
 #include "datastructures/queues/LCRQueueOrcGC.hpp"
+#include "datastructures/queues/LCRQueuePortableOrcGC.hpp"
 #include "datastructures/queues/MichaelScottQueue.hpp"
 #include "datastructures/queues/MichaelScottQueueOrcGC.hpp"
 #include "datastructures/queues/TurnQueue.hpp"
@@ -22,12 +23,33 @@
 
 #define MILLION  1000000LL
 
+// Private OrcGC domains, for the Michael-Scott queues that run next to the queues of g_ptp (see Domains in OrcPTP.hpp)
+PassThePointerOrcGC g_queue_domain {};
+PassThePointerOrcGC g_group_domain {};
+
+/*
+ * A group of queues that share one domain. Each thread enqueues and dequeues on the queue of tid%N
+ */
+template<typename Q, int N>
+class QueueGroup {
+    Q queues[N];
+public:
+    static std::string className() { return Q::className() + "-Group" + std::to_string(N); }
+    void enqueue(UserData* item) { queues[ThreadRegistry::getTID()%N].enqueue(item); }
+    UserData* dequeue() { return queues[ThreadRegistry::getTID()%N].dequeue(); }
+};
+
 int main(int argc, char* argv[]) {
     CmdLineConfig cfg;
     cfg.parseCmdLine(argc,argv);
     cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
 
     const std::string dataFilename { "data/q-ll.txt" };
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    // With --latency, the percentiles are saved into data/<benchmark>-latency.txt (see LatencyHistogram.hpp)
+    LatencyTable latencyTable { dataFilename.substr(0, dataFilename.size()-4) + "-latency.txt", cfg.latency };
     const long numPairs = 10*MILLION;                                  // 10M is fast enough on the laptop, but on AWS we can use 100M
     const int EMAX_CLASS = 100;
     uint64_t results[EMAX_CLASS][cfg.threads.size()];
@@ -40,7 +62,7 @@ int main(int argc, char* argv[]) {
     for (int it = 0; it < cfg.threads.size(); it++) {
         int nThreads = cfg.threads[it];
         int ic = 0;
-        BenchmarkQueues bench(nThreads);
+        BenchmarkQueues bench(nThreads, &memSampler, &latencyTable);
         std::cout << "\n----- q-ll-enq-deq   threads=" << nThreads << "   pairs=" << numPairs/MILLION << "M   runs=" << cfg.runs << " -----\n";
 
         // Maged Michael and Michael Scott's lock-free queue
@@ -62,6 +84,8 @@ int main(int argc, char* argv[]) {
         ic++;
         results[ic][it] = bench.enqDeq<LCRQueueOrcGC<UserData>>                         (cNames[ic], numPairs, cfg.runs);
         ic++;
+        results[ic][it] = bench.enqDeq<LCRQueuePortableOrcGC<UserData>>                 (cNames[ic], numPairs, cfg.runs);
+        ic++;
 
         // Turn queue (wait-free)
         results[ic][it] = bench.enqDeq<TurnQueue<UserData,HazardPointers>>    (cNames[ic], numPairs, cfg.runs);
@@ -72,6 +96,27 @@ int main(int argc, char* argv[]) {
         ic++;
         results[ic][it] = bench.enqDeq<TurnQueueOrcGC<UserData>>              (cNames[ic], numPairs, cfg.runs);
         ic++;
+
+        // Michael-Scott again, alone on its own domain and as a group of 4 queues on another one, while
+        // g_ptp has the hazardous pointers of all the queues above
+        results[ic][it] = bench.enqDeq<MichaelScottQueueOrcGC<UserData,false,false,g_queue_domain>>                   (cNames[ic], numPairs, cfg.runs);
+        ic++;
+        results[ic][it] = bench.enqDeq<QueueGroup<MichaelScottQueueOrcGC<UserData,false,false,g_group_domain>,4>>     (cNames[ic], numPairs, cfg.runs);
+        ic++;
+
+        // With --batch, the OrcGC queues again with enqueueBatch()/dequeueBatch()
+        if (cfg.batch > 0) {
+            results[ic][it] = bench.enqDeqBatch<MichaelScottQueueOrcGC<UserData>>     (cNames[ic], numPairs, cfg.runs, cfg.batch);
+            ic++;
+            results[ic][it] = bench.enqDeqBatch<MichaelScottQueueOrcGC<UserData,false,false,g_queue_domain>> (cNames[ic], numPairs, cfg.runs, cfg.batch);
+            ic++;
+            results[ic][it] = bench.enqDeqBatch<LCRQueueOrcGC<UserData>>              (cNames[ic], numPairs, cfg.runs, cfg.batch);
+            ic++;
+            results[ic][it] = bench.enqDeqBatch<LCRQueuePortableOrcGC<UserData>>      (cNames[ic], numPairs, cfg.runs, cfg.batch);
+            ic++;
+            results[ic][it] = bench.enqDeqBatch<TurnQueueOrcGC<UserData>>             (cNames[ic], numPairs, cfg.runs, cfg.batch);
+            ic++;
+        }
         /*
         // BitNext lock-free queue
         results[ic][it] = bench.enqDeq<BitNextQueue<UserData,HazardPointers>>         (cNames[ic], numPairs, cfg.runs);
@@ -135,6 +180,7 @@ int main(int argc, char* argv[]) {
     }
     dataFile.close();
     std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+    latencyTable.save();
 
     return 0;
 }
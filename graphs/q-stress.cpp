@@ -0,0 +1,98 @@
+/*
+ * Stress test of the portable LCRQ, meant to be built with -fsanitize=thread (make tsan).
+ * Each thread enqueues its own items, one at a time or in batches, and dequeues as many as it enqueued.
+ * The rings are small so that they are closed, replaced and recycled all the time.
+ * Checks that every item is dequeued exactly once and that the items of each producer are seen in order.
+ * The number of items per thread is 10 times --keys.
+ */
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "common/CmdLineConfig.hpp"
+#include "datastructures/queues/LCRQueuePortableOrcGC.hpp"
+
+
+struct StressItem {
+    int  tid;
+    long seq;
+};
+
+// Returns the number of errors
+template<typename Q>
+long stress(const int numThreads, const long numItems, const int batchSize) {
+    std::cout << "##### " << Q::className() << "   threads=" << numThreads << "   items=" << numItems << "   batch=" << batchSize << " #####\n";
+    Q* queue = new Q();
+    std::vector<StressItem> items(numThreads*numItems);
+    std::vector<std::atomic<int>> seen(numThreads*numItems);
+    for (auto& s : seen) s.store(0, std::memory_order_relaxed);
+    std::atomic<long> errors {0};
+
+    // Takes note of an item and checks that it comes after the previous one of the same producer
+    auto check = [&](StressItem* item, std::vector<long>& lastSeq) {
+        if (item == nullptr) {
+            errors.fetch_add(1);
+            return;
+        }
+        if (item->seq <= lastSeq[item->tid]) errors.fetch_add(1);
+        lastSeq[item->tid] = item->seq;
+        seen[item->tid*numItems + item->seq].fetch_add(1);
+    };
+
+    auto stress_lambda = [&](const int tid) {
+        std::vector<long> lastSeq(numThreads, -1);
+        std::vector<StressItem*> batch(batchSize);
+        for (long seq = 0; seq < numItems; seq++) {
+            items[tid*numItems + seq] = {tid, seq};
+        }
+        for (long seq = 0; seq < numItems; seq += batchSize) {
+            const int n = (int)std::min((long)batchSize, numItems - seq);
+            if (batchSize == 1) {
+                queue->enqueue(&items[tid*numItems + seq]);
+                check(queue->dequeue(), lastSeq);
+                continue;
+            }
+            for (int i = 0; i < n; i++) batch[i] = &items[tid*numItems + seq + i];
+            queue->enqueueBatch(batch.data(), n);
+            // Each item we enqueued means there is at least one item in the queue for us
+            for (int count = 0; count < n;) {
+                const int got = queue->dequeueBatch(batch.data(), n - count);
+                if (got == 0) {
+                    errors.fetch_add(1);
+                    break;
+                }
+                for (int i = 0; i < got; i++) check(batch[i], lastSeq);
+                count += got;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < numThreads; tid++) threads.emplace_back(stress_lambda, tid);
+    for (auto& t : threads) t.join();
+    if (queue->dequeue() != nullptr) errors.fetch_add(1);
+    for (auto& s : seen) if (s.load() != 1) errors.fetch_add(1);
+    delete queue;
+    if (errors.load() != 0) std::cout << "ERROR: " << errors.load() << " items were lost, duplicated or out of order\n";
+    return errors.load();
+}
+
+
+int main(int argc, char* argv[]) {
+    CmdLineConfig cfg;
+    cfg.parseCmdLine(argc,argv);
+    cfg.print();
+
+    const long numItems = 10*cfg.keys;
+    long errors = 0;
+    for (unsigned it = 0; it < cfg.threads.size(); it++) {
+        const int nThreads = cfg.threads[it];
+        // Rings of 16 cells
+        errors += stress<LCRQueuePortableOrcGC<StressItem,4>>(nThreads, numItems, 1);
+        errors += stress<LCRQueuePortableOrcGC<StressItem,4>>(nThreads, numItems, 7);
+        errors += stress<LCRQueuePortableOrcGC<StressItem,4>>(nThreads, numItems, 40);
+    }
+    std::cout << ((errors == 0) ? "\nNo errors\n" : "\nThere were errors\n");
+    return (errors == 0) ? 0 : 1;
+}
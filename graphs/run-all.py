@@ -12,10 +12,13 @@ cmd_line_options = " --duration="+time_duration+"  --runs="+num_runs+" --threads
 # Names for linked lists in set-ll-1k
 ll_name_list = [
     "mh-hp",        # Michael-Harris with Hazard Pointers
+    "mh-hpb",       # Michael-Harris with Hazard Pointers in batched mode (R = 2*threads*hps)
     "mh-ptb",       # Michael-Harris with Pass The Buck
     "mh-ptp",       # Michael-Harris with Pass The Pointer
     "mh-ttp",       # Michael-Harris with Tag The Pointer
     "mh-orc",       # Michael-Harris with OrcGC
+    "mh-orc-compact", # Michael-Harris with OrcGC and nodes without padding
+    "mh-map-orc",   # Michael-Harris map with OrcGC, updates are in-place put()
     "ho-orc",       # Harris original with OrcGC
     "hsh-orc",      # Herlihy-Shavit-Harris with OrcGC
     "tbkp-orc",     # Timant-Braginsky-Kogan-Petrank with OrcGC
@@ -24,16 +27,34 @@ ll_name_list = [
 # Names for linked lists in set-tree-1m
 tree_name_list = [
     "nata-hp",        # Natarajan-Mittal with Hazard Pointers
+    "nata-hpb",       # Natarajan-Mittal with Hazard Pointers in batched mode (R = 2*threads*hps)
     "nata-ptb",       # Natarajan-Mittal with Pass The Buck
     "nata-ptp",       # Natarajan-Mittal with Pass The Pointer
     "nata-ttp",       # Natarajan-Mittal with Tag The Pointer
     "nata-orc",       # Natarajan-Mittal with OrcGC
+    "nata-orc-scan",  # Natarajan-Mittal with OrcGC where the readers do range queries of 100 keys
+    "nata-orc-snap",  # Natarajan-Mittal with OrcGC where the readers do linearizable range queries of 100 keys
+    "nata-orc-cl",    # Natarajan-Mittal with OrcGC and nodes aligned to 64 bytes
+    "nata-orc-compact", # Natarajan-Mittal with OrcGC and nodes without padding
+]
+
+# Names for hash maps in set-hash-1m
+hash_name_list = [
+    "mhash-orc",         # Michael hash map with split-ordered buckets with OrcGC
+    "mhash-orc-compact", # Michael hash map with split-ordered buckets with OrcGC and nodes without padding
 ]
 
 # Names for skiplists in set-skiplist-1m
 skiplist_name_list = [
     "hsskip-orcorig", # Original Herlihy Shavit skiplist with OrcGC
     "hsskip-orc",     # Herlihy Shavit skiplist with poison with OrcGC
+    "hsskip-orc-compact", # Herlihy Shavit skiplist with poison with OrcGC and nodes without padding
+    "hsskip-orc-libcrand", # Herlihy Shavit skiplist with OrcGC and the old rand() level generator
+    "hsskip-orc-1m",  # Herlihy Shavit skiplist with OrcGC and levels sized for 1M keys
+    "hsskip-orc-b4",  # Herlihy Shavit skiplist with OrcGC, branching factor 4 and levels sized for 1M keys
+    "hsskip-orc-scan", # Herlihy Shavit skiplist with OrcGC where the readers do range scans of 100 keys
+    "hsskip-orc-snap", # Herlihy Shavit skiplist with OrcGC where the readers do linearizable range scans of 100 keys
+    "hsskip-map-orc", # Herlihy Shavit skiplist map with OrcGC, updates are in-place put()
 ]     
 
 
@@ -47,5 +68,8 @@ for dsname in ll_name_list:
 for dsname in tree_name_list:
     os.system(bin_folder+"set-tree-1m "+ dsname + cmd_line_options + " --keys=1000000")
 
+for dsname in hash_name_list:
+    os.system(bin_folder+"set-hash-1m "+ dsname + cmd_line_options + " --keys=1000000")
+
 for dsname in skiplist_name_list:
     os.system(bin_folder+"set-skiplist-1m "+ dsname + cmd_line_options + " --keys=1000000")
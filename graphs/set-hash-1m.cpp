@@ -0,0 +1,103 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <string>
+
+#include "BenchmarkSets.hpp"
+#include "common/CmdLineConfig.hpp"
+#include "trackers/HazardPointers.hpp"
+#include "trackers/PassThePointer.hpp"
+#include "trackers/PassTheBuck.hpp"
+#include "datastructures/hashmaps/MichaelHashMapOrcGC.hpp"
+
+
+int main(int argc, char* argv[]) {
+    CmdLineConfig cfg;
+    cfg.parseCmdLine(argc,argv);
+    cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
+    orcgc_ptp::g_orc_pool_hugepages = cfg.hugepages;
+
+    std::string dataFilename { "data/set-hash-1m.txt" };
+    // Read the name of data structure from the command line
+    char *dsname = (argc >= 2) ? argv[1] : nullptr;
+    // Adjust the name of the output file accordingly
+    if (dsname == nullptr) {
+        dataFilename = { "data/set-hash-1m.txt" };
+    } else {
+        dataFilename = { "data/set-hash-1m-"+std::string{dsname}+".txt" };
+    }
+    // Keep the results with huge pages apart so that they can be compared with the default ones
+    if (cfg.hugepages) dataFilename.insert(dataFilename.size()-4, "-hugepages");
+    // Keep the results with bulk loaded sets apart, they don't start with the same shape
+    if (cfg.bulk) dataFilename.insert(dataFilename.size()-4, "-bulk");
+    // Keep the results of each key distribution apart (see KeyDistribution.hpp)
+    dataFilename.insert(dataFilename.size()-4, KeyDistribution::fileSuffix(cfg.dist));
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    // With --latency, the percentiles are saved into data/<benchmark>-latency.txt (see LatencyHistogram.hpp)
+    LatencyTable latencyTable { dataFilename.substr(0, dataFilename.size()-4) + "-latency.txt", cfg.latency };
+    // With --rates, the sets run open-loop and the latencies for each rate are saved into data/<benchmark>-openloop.txt
+    LatencyTable openLoopTable { dataFilename.substr(0, dataFilename.size()-4) + "-openloop.txt", !cfg.rates.empty(), "TargetRate", true };
+    seconds testLength {cfg.duration};
+    const int EMAX_CLASS = 30;
+    uint64_t results[EMAX_CLASS][cfg.threads.size()][cfg.ratios.size()];
+    std::string cNames[EMAX_CLASS];
+    int maxClass = 0;
+    // Reset results
+    std::memset(results, 0, sizeof(uint64_t)*EMAX_CLASS*cfg.threads.size()*cfg.ratios.size());
+
+    double totalHours = (double)EMAX_CLASS*cfg.ratios.size()*cfg.threads.size()*testLength.count()*cfg.runs/(60.*60.);
+    std::cout << "This benchmark is going to take at most " << totalHours << " hours to complete\n";
+
+    for (unsigned ir = 0; ir < cfg.ratios.size(); ir++) {
+        auto ratio = cfg.ratios[ir];
+        for (unsigned it = 0; it < cfg.threads.size(); it++) {
+            auto nThreads = cfg.threads[it];
+            int ic = 0;
+            BenchmarkSets bench(nThreads, &memSampler, &latencyTable);
+            bench.setKeyDistribution(cfg.dist);
+            bench.setBulkLoad(cfg.bulk);
+            if (!cfg.rates.empty()) bench.openLoop(cfg.rates, &openLoopTable);
+            std::cout << "\n----- Sets (Hash Maps)   numKeys=" << cfg.keys << "   ratio=" << ratio/10. << "%   threads=" << nThreads << "   runs=" << cfg.runs << "   length=" << testLength.count() << "s -----\n";
+            if (dsname == nullptr || std::strcmp(dsname, "mhash-orc") == 0) {
+                results[ic][it][ir] = bench.benchmarkRandomFill<MichaelHashMapOrcGC<uint64_t,uint64_t>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "mhash-orc-compact") == 0) {
+                results[ic][it][ir] = bench.benchmarkRandomFill<MichaelHashMapOrcGC<uint64_t,uint64_t,CompactLayout>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+
+            maxClass = ic;
+        }
+    }
+
+    if (maxClass == 0) {
+        std::cout << "unrecognized command line option...\n";
+        return 0;
+    }
+    // Export tab-separated values to a file to be imported in gnuplot or excel
+    ofstream dataFile;
+    dataFile.open(dataFilename);
+    dataFile << "Threads\t";
+    // Printf class names and ratios for each column
+    for (unsigned iratio = 0; iratio < cfg.ratios.size(); iratio++) {
+        auto ratio = cfg.ratios[iratio];
+        for (int iclass = 0; iclass < maxClass; iclass++) dataFile << cNames[iclass] << "-" << ratio/10. << "%"<< "\t";
+    }
+    dataFile << "\n";
+    for (int it = 0; it < cfg.threads.size(); it++) {
+        dataFile << cfg.threads[it] << "\t";
+        for (unsigned ir = 0; ir < cfg.ratios.size(); ir++) {
+            for (int ic = 0; ic < maxClass; ic++) dataFile << results[ic][it][ir] << "\t";
+        }
+        dataFile << "\n";
+    }
+    dataFile.close();
+    std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+    latencyTable.save();
+    openLoopTable.save();
+
+    return 0;
+}
@@ -10,6 +10,7 @@
 #include "trackers/PassTheBuck.hpp"
 #include "datastructures/lists/MichaelHarrisLinkedListSet.hpp"
 #include "datastructures/lists/MichaelHarrisLinkedListSetOrcGC.hpp"
+#include "datastructures/lists/MichaelHarrisLinkedListMapOrcGC.hpp"
 #include "datastructures/lists/HarrisOriginalLinkedListSetOrcGC.hpp"
 #include "datastructures/lists/HerlihyShavitHarrisLinkedListSetOrcGC.hpp"
 #include "datastructures/lists/TBKPLinkedListSetOrcGC.hpp"
@@ -24,6 +25,8 @@ int main(int argc, char* argv[]) {
     CmdLineConfig cfg;
     cfg.parseCmdLine(argc,argv);
     cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
+    orcgc_ptp::g_orc_pool_hugepages = cfg.hugepages;
 
     std::string dataFilename { "data/set-ll-1k.txt" };
     // Adjust the name of the output file accordingly
@@ -35,6 +38,18 @@ int main(int argc, char* argv[]) {
     } else {
         dataFilename = { "data/set-ll-1k-"+std::string{dsname}+".txt" };
     }
+    // Keep the results with huge pages apart so that they can be compared with the default ones
+    if (cfg.hugepages) dataFilename.insert(dataFilename.size()-4, "-hugepages");
+    // Keep the results with bulk loaded sets apart, they don't start with the same shape
+    if (cfg.bulk) dataFilename.insert(dataFilename.size()-4, "-bulk");
+    // Keep the results of each key distribution apart (see KeyDistribution.hpp)
+    dataFilename.insert(dataFilename.size()-4, KeyDistribution::fileSuffix(cfg.dist));
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    // With --latency, the percentiles are saved into data/<benchmark>-latency.txt (see LatencyHistogram.hpp)
+    LatencyTable latencyTable { dataFilename.substr(0, dataFilename.size()-4) + "-latency.txt", cfg.latency };
+    // With --rates, the sets run open-loop and the latencies for each rate are saved into data/<benchmark>-openloop.txt
+    LatencyTable openLoopTable { dataFilename.substr(0, dataFilename.size()-4) + "-openloop.txt", !cfg.rates.empty(), "TargetRate", true };
     seconds testLength {cfg.duration};
     const int EMAX_CLASS = 30;
     uint64_t results[EMAX_CLASS][cfg.threads.size()][cfg.ratios.size()];
@@ -51,12 +66,19 @@ int main(int argc, char* argv[]) {
         for (unsigned it = 0; it < cfg.threads.size(); it++) {
             auto nThreads = cfg.threads[it];
             int ic = 0;
-            BenchmarkSets bench(nThreads);
+            BenchmarkSets bench(nThreads, &memSampler, &latencyTable);
+            bench.setKeyDistribution(cfg.dist);
+            bench.setBulkLoad(cfg.bulk);
+            if (!cfg.rates.empty()) bench.openLoop(cfg.rates, &openLoopTable);
             std::cout << "\n----- Sets (Linked-Lists)   numKeys=" << cfg.keys << "   ratio=" << ratio/10. << "%   threads=" << nThreads << "   runs=" << cfg.runs << "   length=" << testLength.count() << "s -----\n";
             if (dsname == nullptr || std::strcmp(dsname, "mh-hp") == 0) {
                 results[ic][it][ir] = bench.benchmark<MichaelHarrisLinkedListSet<UserWord,HazardPointers>,UserWord>            (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
             }
+            if (dsname == nullptr || std::strcmp(dsname, "mh-hpb") == 0) {
+                results[ic][it][ir] = bench.benchmark<MichaelHarrisLinkedListSet<UserWord,HazardPointersBatched>,UserWord>     (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
             if (dsname == nullptr || std::strcmp(dsname, "mh-ptb") == 0) {
                 results[ic][it][ir] = bench.benchmark<MichaelHarrisLinkedListSet<UserWord,PassTheBuck>,UserWord>               (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
@@ -69,6 +91,14 @@ int main(int argc, char* argv[]) {
                 results[ic][it][ir] = bench.benchmark<MichaelHarrisLinkedListSetOrcGC<UserWord>,UserWord>                      (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
             }
+            if (dsname == nullptr || std::strcmp(dsname, "mh-orc-compact") == 0) {
+                results[ic][it][ir] = bench.benchmark<MichaelHarrisLinkedListSetOrcGC<UserWord,CompactLayout>,UserWord>        (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "mh-map-orc") == 0) {
+                results[ic][it][ir] = bench.benchmarkMapPut<MichaelHarrisLinkedListMapOrcGC<UserWord,UserWord>,UserWord>      (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
             if (dsname == nullptr || std::strcmp(dsname, "ho-orc") == 0) {
                 results[ic][it][ir] = bench.benchmark<HarrisOriginalLinkedListSetOrcGC<UserWord>,UserWord>                     (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
@@ -108,6 +138,8 @@ int main(int argc, char* argv[]) {
     }
     dataFile.close();
     std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+    latencyTable.save();
+    openLoopTable.save();
 
     return 0;
 }
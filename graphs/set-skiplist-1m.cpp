@@ -10,6 +10,7 @@
 #include "trackers/PassTheBuck.hpp"
 #include "datastructures/skiplists/HerlihyShavitLockFreeSkipListOrcGC.hpp"
 #include "datastructures/skiplists/HerlihyShavitLockFreeSkipListOrcGCOrig.hpp"
+#include "datastructures/skiplists/HerlihyShavitLockFreeSkipListMapOrcGC.hpp"
 
 
 //
@@ -20,6 +21,8 @@ int main(int argc, char* argv[]) {
     CmdLineConfig cfg;
     cfg.parseCmdLine(argc,argv);
     cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
+    orcgc_ptp::g_orc_pool_hugepages = cfg.hugepages;
 
     // Adjust the name of the output file accordingly
     std::string dataFilename;
@@ -30,6 +33,18 @@ int main(int argc, char* argv[]) {
     } else {
         dataFilename = { "data/set-skiplist-1m-"+std::string{dsname}+".txt" };
     }
+    // Keep the results with huge pages apart so that they can be compared with the default ones
+    if (cfg.hugepages) dataFilename.insert(dataFilename.size()-4, "-hugepages");
+    // Keep the results with bulk loaded sets apart, they don't start with the same shape
+    if (cfg.bulk) dataFilename.insert(dataFilename.size()-4, "-bulk");
+    // Keep the results of each key distribution apart (see KeyDistribution.hpp)
+    dataFilename.insert(dataFilename.size()-4, KeyDistribution::fileSuffix(cfg.dist));
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    // With --latency, the percentiles are saved into data/<benchmark>-latency.txt (see LatencyHistogram.hpp)
+    LatencyTable latencyTable { dataFilename.substr(0, dataFilename.size()-4) + "-latency.txt", cfg.latency };
+    // With --rates, the sets run open-loop and the latencies for each rate are saved into data/<benchmark>-openloop.txt
+    LatencyTable openLoopTable { dataFilename.substr(0, dataFilename.size()-4) + "-openloop.txt", !cfg.rates.empty(), "TargetRate", true };
     seconds testLength {cfg.duration};
     const int EMAX_CLASS = 30;
     uint64_t results[EMAX_CLASS][cfg.threads.size()][cfg.ratios.size()];
@@ -45,7 +60,10 @@ int main(int argc, char* argv[]) {
         for (unsigned it = 0; it < cfg.threads.size(); it++) {
             auto nThreads = cfg.threads[it];
             int ic = 0;
-            BenchmarkSets bench(nThreads);
+            BenchmarkSets bench(nThreads, &memSampler, &latencyTable);
+            bench.setKeyDistribution(cfg.dist);
+            bench.setBulkLoad(cfg.bulk);
+            if (!cfg.rates.empty()) bench.openLoop(cfg.rates, &openLoopTable);
             std::cout << "\n----- Sets (Skiplist)   numkeys=" << cfg.keys << "   ratio=" << ratio/10. << "%   threads=" << nThreads << "   runs=" << cfg.runs << "   length=" << testLength.count() << "s -----\n";
             if (dsname == nullptr || std::strcmp(dsname, "hsskip-orcorig") == 0) {
 				results[ic][it][ir] = bench.benchmark<HerlihyShavitLockFreeSkipListOrcGCOrig<UserWord>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
@@ -55,6 +73,34 @@ int main(int argc, char* argv[]) {
 				results[ic][it][ir] = bench.benchmark<HerlihyShavitLockFreeSkipListOrcGC<UserWord>,UserWord>     (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
 				ic++;
 			}
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-orc-compact") == 0) {
+				results[ic][it][ir] = bench.benchmark<HerlihyShavitLockFreeSkipListOrcGC<UserWord,CompactLayout>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+				ic++;
+			}
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-orc-libcrand") == 0) {
+				results[ic][it][ir] = bench.benchmark<HerlihyShavitLockFreeSkipListOrcGC<UserWord,PaddedLayout,LibcRandLevel>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-orc-1m") == 0) {
+				results[ic][it][ir] = bench.benchmark<HerlihyShavitLockFreeSkipListOrcGC<UserWord,PaddedLayout,XorshiftLevel<2,1000000>>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-orc-b4") == 0) {
+				results[ic][it][ir] = bench.benchmark<HerlihyShavitLockFreeSkipListOrcGC<UserWord,PaddedLayout,XorshiftLevel<4,1000000>>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-orc-scan") == 0) {
+				results[ic][it][ir] = bench.benchmarkScans<HerlihyShavitLockFreeSkipListOrcGC<UserWord>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-orc-snap") == 0) {
+				results[ic][it][ir] = bench.benchmarkScans<HerlihyShavitLockFreeSkipListOrcGC<UserWord,PaddedLayout,XorshiftLevel<>,OrcSnapshot>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "hsskip-map-orc") == 0) {
+				results[ic][it][ir] = bench.benchmarkMapPut<HerlihyShavitLockFreeSkipListMapOrcGC<UserWord,UserWord>,UserWord> (cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
             maxClass = ic;
         }
     }
@@ -82,6 +128,8 @@ int main(int argc, char* argv[]) {
     }
     dataFile.close();
     std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+    latencyTable.save();
+    openLoopTable.save();
 
     return 0;
 }
@@ -0,0 +1,78 @@
+/*
+ * Stress test of the snapshot range counts of the Natarajan tree, meant to be built with -fsanitize=thread (make tsan).
+ * In each round the tree is filled with --keys keys, and half of the threads remove all of them, interleaved
+ * so that neighbouring leaves are removed at the same time, while the other half do rangeCount() of all the keys.
+ * The set only shrinks, therefore each count must be between the number of keys whose remove had not started
+ * when the count ended and the number of keys whose remove had not completed when it started, and the counts
+ * seen by each thread can not go up.
+ * There are 20 rounds.
+ */
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "common/CmdLineConfig.hpp"
+#include "datastructures/trees/NatarajanTreeOrcGC.hpp"
+
+
+// Returns the number of errors
+template<typename S>
+long stress(const int numThreads, const long numKeys, const int numRounds) {
+    const int numRemovers = std::max(1, numThreads/2);
+    const int numCounters = std::max(1, numThreads - numRemovers);
+    std::cout << "##### " << S::className() << "   removers=" << numRemovers << "   counters=" << numCounters << "   keys=" << numKeys << " #####\n";
+    S* set = new S();
+    std::atomic<long> errors {0};
+
+    for (int round = 0; round < numRounds; round++) {
+        for (long key = 0; key < numKeys; key++) set->add(key);
+        std::atomic<long> started {0};
+        std::atomic<long> completed {0};
+        std::atomic<int> removersDone {0};
+
+        auto remove_lambda = [&](const int tid) {
+            for (long key = tid; key < numKeys; key += numRemovers) {
+                started.fetch_add(1);
+                if (!set->remove(key)) errors.fetch_add(1);
+                completed.fetch_add(1);
+            }
+            removersDone.fetch_add(1);
+        };
+
+        auto count_lambda = [&]() {
+            long lastCount = numKeys;
+            while (removersDone.load() != numRemovers) {
+                const long maxCount = numKeys - completed.load();
+                const long count = set->rangeCount(0, numKeys-1);
+                const long minCount = numKeys - started.load();
+                if (count < minCount || count > maxCount || count > lastCount) errors.fetch_add(1);
+                lastCount = count;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int tid = 0; tid < numRemovers; tid++) threads.emplace_back(remove_lambda, tid);
+        for (int tid = 0; tid < numCounters; tid++) threads.emplace_back(count_lambda);
+        for (auto& t : threads) t.join();
+        if (set->rangeCount(0, numKeys-1) != 0) errors.fetch_add(1);
+    }
+    delete set;
+    if (errors.load() != 0) std::cout << "ERROR: " << errors.load() << " failed removes or wrong range counts\n";
+    return errors.load();
+}
+
+
+int main(int argc, char* argv[]) {
+    CmdLineConfig cfg;
+    cfg.parseCmdLine(argc,argv);
+    cfg.print();
+
+    long errors = 0;
+    for (unsigned it = 0; it < cfg.threads.size(); it++) {
+        const int nThreads = cfg.threads[it];
+        errors += stress<NatarajanTreeOrcGC<uint64_t,uint64_t,PaddedLayout,OrcSnapshot>>(nThreads, cfg.keys, 20);
+    }
+    std::cout << ((errors == 0) ? "\nNo errors\n" : "\nThere were errors\n");
+    return (errors == 0) ? 0 : 1;
+}
@@ -16,6 +16,8 @@ int main(int argc, char* argv[]) {
     CmdLineConfig cfg;
     cfg.parseCmdLine(argc,argv);
     cfg.print();
+    orcgc_ptp::g_orc_pool_enabled = cfg.pool;
+    orcgc_ptp::g_orc_pool_hugepages = cfg.hugepages;
 
     std::string dataFilename { "data/set-tree-1m.txt" };
     // Read the name of data structure from the command line
@@ -27,6 +29,18 @@ int main(int argc, char* argv[]) {
     } else {
         dataFilename = { "data/set-tree-1m-"+std::string{dsname}+".txt" };
     }
+    // Keep the results with huge pages apart so that they can be compared with the default ones
+    if (cfg.hugepages) dataFilename.insert(dataFilename.size()-4, "-hugepages");
+    // Keep the results with bulk loaded sets apart, they don't start with the same shape
+    if (cfg.bulk) dataFilename.insert(dataFilename.size()-4, "-bulk");
+    // Keep the results of each key distribution apart (see KeyDistribution.hpp)
+    dataFilename.insert(dataFilename.size()-4, KeyDistribution::fileSuffix(cfg.dist));
+    // With --memsample, the memory usage is sampled into data/<benchmark>-mem.txt (see MemorySampler.hpp)
+    MemorySampler memSampler { dataFilename.substr(0, dataFilename.size()-4) + "-mem.txt", (int)cfg.memsample };
+    // With --latency, the percentiles are saved into data/<benchmark>-latency.txt (see LatencyHistogram.hpp)
+    LatencyTable latencyTable { dataFilename.substr(0, dataFilename.size()-4) + "-latency.txt", cfg.latency };
+    // With --rates, the sets run open-loop and the latencies for each rate are saved into data/<benchmark>-openloop.txt
+    LatencyTable openLoopTable { dataFilename.substr(0, dataFilename.size()-4) + "-openloop.txt", !cfg.rates.empty(), "TargetRate", true };
     seconds testLength {cfg.duration};
     const int EMAX_CLASS = 30;
     uint64_t results[EMAX_CLASS][cfg.threads.size()][cfg.ratios.size()];
@@ -43,7 +57,10 @@ int main(int argc, char* argv[]) {
         for (unsigned it = 0; it < cfg.threads.size(); it++) {
             auto nThreads = cfg.threads[it];
             int ic = 0;
-            BenchmarkSets bench(nThreads);
+            BenchmarkSets bench(nThreads, &memSampler, &latencyTable);
+            bench.setKeyDistribution(cfg.dist);
+            bench.setBulkLoad(cfg.bulk);
+            if (!cfg.rates.empty()) bench.openLoop(cfg.rates, &openLoopTable);
             std::cout << "\n----- Sets (Trees)   numKeys=" << cfg.keys << "   ratio=" << ratio/10. << "%   threads=" << nThreads << "   runs=" << cfg.runs << "   length=" << testLength.count() << "s -----\n";
             //if (dsname == nullptr || std::strcmp(dsname, "efrb-orc") == 0) {
             //    results[ic][it][ir] = bench.benchmarkRandomFill<EFRBBSTMapOrcGC<UserWord,UserWord>,UserWord>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
@@ -53,6 +70,10 @@ int main(int argc, char* argv[]) {
                 results[ic][it][ir] = bench.benchmarkRandomFill<NatarajanTree<uint64_t,uint64_t,HazardPointers>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
             }
+            if (dsname == nullptr || std::strcmp(dsname, "nata-hpb") == 0) {
+                results[ic][it][ir] = bench.benchmarkRandomFill<NatarajanTree<uint64_t,uint64_t,HazardPointersBatched>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
             if (dsname == nullptr || std::strcmp(dsname, "nata-ptb") == 0) {
                 results[ic][it][ir] = bench.benchmarkRandomFill<NatarajanTree<uint64_t,uint64_t,PassTheBuck>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
@@ -65,6 +86,22 @@ int main(int argc, char* argv[]) {
                 results[ic][it][ir] = bench.benchmarkRandomFill<NatarajanTreeOrcGC<uint64_t,uint64_t>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
                 ic++;
             }
+            if (dsname == nullptr || std::strcmp(dsname, "nata-orc-scan") == 0) {
+                results[ic][it][ir] = bench.benchmarkScans<NatarajanTreeOrcGC<uint64_t,uint64_t>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "nata-orc-snap") == 0) {
+                results[ic][it][ir] = bench.benchmarkScans<NatarajanTreeOrcGC<uint64_t,uint64_t,PaddedLayout,OrcSnapshot>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "nata-orc-cl") == 0) {
+                results[ic][it][ir] = bench.benchmarkRandomFill<NatarajanTreeOrcGC<uint64_t,uint64_t,CacheLineLayout>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
+            if (dsname == nullptr || std::strcmp(dsname, "nata-orc-compact") == 0) {
+                results[ic][it][ir] = bench.benchmarkRandomFill<NatarajanTreeOrcGC<uint64_t,uint64_t,CompactLayout>,uint64_t>(cNames[ic], ratio, testLength, cfg.runs, cfg.keys, false);
+                ic++;
+            }
 
             maxClass = ic;
         }
@@ -93,6 +130,8 @@ int main(int argc, char* argv[]) {
     }
     dataFile.close();
     std::cout << "\nSuccessfuly saved results in " << dataFilename << "\n";
+    latencyTable.save();
+    openLoopTable.save();
 
     return 0;
 }
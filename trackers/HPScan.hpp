@@ -0,0 +1,88 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#if defined(__x86_64__) && (defined(__AVX512F__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+
+/*
+ * Vectorized scans over a row of hazardous pointers (or handovers).
+ *
+ * hpscan_find(row, len, val) returns the first index in [0,len) where row[i] == val, or -1.
+ * hpscan_find_not(row, len, val) returns the first index in [0,len) where row[i] != val, or -1.
+ *
+ * The kernel is chosen at compile time: AVX-512 tests 8 slots per instruction, AVX2 tests 4,
+ * and when neither is enabled (or not on x86) each slot is loaded one at a time.
+ * Compile with -march=native (or -mavx2 / -mavx512f) to get the vector kernels.
+ *
+ * The vector loads are plain loads of the std::atomic<T*> slots. On x86 an aligned 8 byte
+ * access is atomic and loads are not reordered with other loads, therefore each lane has the
+ * same semantics as a seq_cst/acquire load() (which on x86 are a plain mov as well).
+ * The compiler barriers prevent the compiler from moving these loads across the surrounding
+ * atomic operations.
+ * A hit is only a hint: the callers re-check the slot with a load() before acting on it,
+ * and a miss means there was no match at the time the row was read, just like in a scalar scan.
+ *
+ * Each tracker chooses whether to use these functions with its own 'useVectorScan' flag.
+ */
+
+template<typename T> inline T hpscan_load(const std::atomic<T>& slot) { return slot.load(std::memory_order_acquire); }
+template<typename T> inline T hpscan_load(const T& slot) { return slot; }
+
+// 'S' is either std::atomic<T*> or T*
+template<bool match, typename S>
+inline int hpscan_row(const S* row, const int len, const void* val) {
+    static_assert(sizeof(S) == sizeof(uint64_t), "hpscan works only on rows of 8 byte slots");
+    int i = 0;
+#if defined(__x86_64__) && (defined(__AVX512F__) || defined(__AVX2__))
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#if defined(__AVX512F__)
+    const __m512i vval = _mm512_set1_epi64((long long)(uintptr_t)val);
+    for (; i + 8 <= len; i += 8) {
+        const __m512i vrow = _mm512_loadu_si512((const void*)(row + i));
+        const __mmask8 mask = match ? _mm512_cmpeq_epi64_mask(vrow, vval) : _mm512_cmpneq_epi64_mask(vrow, vval);
+        if (mask != 0) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            return i + __builtin_ctz(mask);
+        }
+    }
+#else
+    const __m256i vval = _mm256_set1_epi64x((long long)(uintptr_t)val);
+    for (; i + 4 <= len; i += 4) {
+        const __m256i vrow = _mm256_loadu_si256((const __m256i*)(row + i));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(vrow, vval)));
+        if (!match) mask ^= 0xF;
+        if (mask != 0) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    // Scalar fallback, and the tail of the row for the vector kernels
+    for (; i < len; i++) {
+        if (((const void*)hpscan_load(row[i]) == val) == match) return i;
+    }
+    return -1;
+}
+
+template<typename S>
+inline int hpscan_find(const S* row, const int len, const void* val) {
+    return hpscan_row<true>(row, len, val);
+}
+
+template<typename S>
+inline int hpscan_find_not(const S* row, const int len, const void* val) {
+    return hpscan_row<false>(row, len, val);
+}
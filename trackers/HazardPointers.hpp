@@ -11,28 +11,46 @@
 #include <atomic>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include "common/ThreadRegistry.hpp"
+#include "HPScan.hpp"
 
 
 template<typename T>
 class HazardPointers {
 
-private:
+public:
     static const int      MAX_HPS = 32;     // This is named 'K' in the HP paper
-    static const int      CLPAD = 128/sizeof(std::atomic<T*>);
     static const int      HP_THRESHOLD_R = 0; // This is named 'R' in the HP paper
+    static const int      HP_THRESHOLD_AUTO = -1; // R = 2*H, where H = maxThreads*maxHPs
+
+private:
+    static const int      CLPAD = 128/sizeof(std::atomic<T*>);
     static const int      MAX_RETIRED = REGISTRY_MAX_THREADS*MAX_HPS; // Maximum number of retired objects per thread
+    static const bool     useVectorScan = true; // Scan each row of hp[][] with hpscan_find() (see HPScan.hpp)
 
     const int             maxHPs;
+    const int             thresholdR;
 
     alignas(128) std::atomic<T*>      hp[REGISTRY_MAX_THREADS][MAX_HPS];
     // It's not nice that we have a lot of empty vectors, but we need padding to avoid false sharing
     alignas(128) std::vector<T*>       retiredList[REGISTRY_MAX_THREADS*CLPAD];
+    // Snapshot of all the published hps, used only in batched mode (thresholdR != 0)
+    alignas(128) std::vector<T*>       snapshot[REGISTRY_MAX_THREADS*CLPAD];
 
 public:
-    HazardPointers(int maxHPs=MAX_HPS) : maxHPs{maxHPs} {
+    /*
+     * thresholdR is the number of retired objects each thread accumulates before scanning:
+     * - HP_THRESHOLD_R (zero) scans all the hps for each retired object on every call to retire();
+     * - HP_THRESHOLD_AUTO uses R = 2*maxThreads*maxHPs, the value suggested in the HP paper;
+     * - Any positive number is used as R;
+     * In batched mode (R != 0) a scan takes one snapshot of all published hps, sorts it and
+     * looks up each retired object with a binary search, for O(1) amortized cost per object.
+     */
+    HazardPointers(int maxHPs=MAX_HPS, int thresholdR=HP_THRESHOLD_R) : maxHPs{maxHPs}, thresholdR{thresholdR} {
         for (int it = 0; it < REGISTRY_MAX_THREADS; it++) {
         	retiredList[it*CLPAD].reserve(MAX_RETIRED);
+            if (thresholdR != HP_THRESHOLD_R) snapshot[it*CLPAD].reserve(MAX_RETIRED);
             for (int ihp = 0; ihp < MAX_HPS; ihp++) {
                 hp[it][ihp].store(nullptr, std::memory_order_relaxed);
             }
@@ -129,11 +147,19 @@ public:
         const int maxThreads = (int)ThreadRegistry::getMaxThreads();
         auto& rlist = retiredList[tid*CLPAD];
         rlist.push_back(ptr);
-        if (rlist.size() < HP_THRESHOLD_R) return;
+        if (thresholdR != HP_THRESHOLD_R) {
+            const unsigned R = (thresholdR == HP_THRESHOLD_AUTO) ? 2*maxThreads*maxHPs : thresholdR;
+            if (rlist.size() >= R) scanBatch(tid, maxThreads);
+            return;
+        }
         for (unsigned iret = 0; iret < rlist.size();) {
             auto obj = rlist[iret];
             bool canDelete = true;
             for (int tid = 0; tid < maxThreads && canDelete; tid++) {
+                if (useVectorScan) {
+                    if (hpscan_find(hp[tid], maxHPs, obj) >= 0) canDelete = false;
+                    continue;
+                }
                 for (int ihp = 0; ihp < maxHPs; ihp++) {
                     if (hp[tid][ihp].load() == obj) {
                         canDelete = false;
@@ -142,12 +168,55 @@ public:
                 }
             }
             if (canDelete) {
-                rlist.erase(rlist.begin() + iret);
+                // The order of the retired objects doesn't matter: replace with the last one
+                rlist[iret] = rlist.back();
+                rlist.pop_back();
                 delete obj;
                 continue;
             }
             iret++;
         }
     }
+
+private:
+    /**
+     * Batched scan: one pass over hp[][] and then a binary search for each retired object
+     * Progress Condition: wait-free bounded (by maxThreads*maxHPs + R*log(maxThreads*maxHPs))
+     */
+    void scanBatch(const int tid, const int maxThreads) {
+        auto& rlist = retiredList[tid*CLPAD];
+        auto& plist = snapshot[tid*CLPAD];
+        plist.clear();
+        for (int it = 0; it < maxThreads; it++) {
+            for (int ihp = 0; ihp < maxHPs; ihp++) {
+                T* obj = hp[it][ihp].load();
+                if (obj != nullptr) plist.push_back(obj);
+            }
+        }
+        std::sort(plist.begin(), plist.end());
+        for (unsigned iret = 0; iret < rlist.size();) {
+            T* obj = rlist[iret];
+            if (!std::binary_search(plist.begin(), plist.end(), obj)) {
+                rlist[iret] = rlist.back();
+                rlist.pop_back();
+                delete obj;
+                continue;
+            }
+            iret++;
+        }
+    }
+};
+
+
+/*
+ * Hazard Pointers in batched mode, with R = 2*maxThreads*maxHPs.
+ * Meant to be passed as the 'Reclaimer' template parameter of the data structures.
+ */
+template<typename T>
+class HazardPointersBatched : public HazardPointers<T> {
+public:
+    HazardPointersBatched(int maxHPs=HazardPointers<T>::MAX_HPS) : HazardPointers<T>(maxHPs, HazardPointers<T>::HP_THRESHOLD_AUTO) { }
+
+    static std::string className() { return "HazardPointersBatched"; }
 };
 
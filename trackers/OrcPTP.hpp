@@ -14,7 +14,11 @@
 #include <algorithm>
 #include <cstdint>
 #include <cassert>
+#include <typeinfo>
+#include <cxxabi.h>
 #include "common/ThreadRegistry.hpp"
+#include "HPScan.hpp"
+#include "OrcPool.hpp"
 
 
 /*
@@ -28,6 +32,20 @@
  * 3. orc_base: A base class where the _orc counter is stored
  * 4. orc_atomic: A replacement to std::atomic
  *
+ * Domains:
+ * By default everything goes through the global instance g_ptp. A data structure (or a group of them)
+ * can have its own PassThePointerOrcGC instance, so that its retire()/tryHandover() scans only
+ * cover the hp indexes that its own algorithm needs, and not whatever some other data structure
+ * pushed maxHPs up to. The domain is the last template parameter of orc_ptr, orc_atomic and make_orc,
+ * and it must be an object with static storage duration:
+ *
+ * PassThePointerOrcGC g_queue_domain {};
+ * MichaelScottQueueOrcGC<UserData, false, false, g_queue_domain> queue;
+ *
+ * An object must always be protected and retired in the same domain. Because the domain is part of the
+ * type, an orc_ptr of one domain can not be assigned from a load() or an orc_ptr of another one.
+ * With the default parameter the code is the same as when g_ptp was the only domain.
+ *
  * The idea of using ORCs is not new, it has been used in CX and described as early as
  * http://citeseerx.ist.psu.edu/viewdoc/download?doi=10.1.1.149.7259&rep=rep1&type=pdf
  *
@@ -75,13 +93,163 @@ struct orc_base {
 };
 
 
+/*
+ * Statistics of the reclamation in a PassThePointerOrcGC domain, gathered only if this is compiled
+ * with -DUSE_ORC_STATS. Otherwise OrcStats::enabled is false and the counters are never touched.
+ * Each thread updates its own copy, in its TLInfo, with plain (non-atomic) increments.
+ * getStats() adds up all the threads, which is exact only when they are not running.
+ */
+struct OrcStats {
+#ifdef USE_ORC_STATS
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+    uint64_t retired {0};          // Objects given to retire(), including the ones in the recursiveList
+    uint64_t deleted {0};          // Objects whose _deleter was called
+    uint64_t handedOver {0};       // Objects put in a handover because there was an hp on them
+    uint64_t handoverScans {0};    // Scans of all the hps by tryHandover()
+    uint64_t scannedSlots {0};     // Number of hp slots in those scans
+    uint64_t maxRecursion {0};     // Largest recursiveList in a single retire()
+    uint64_t retireOneSweeps {0};  // Calls to retireOne(), one every MAX_RETCNT decrements
+    uint64_t retireOneFound {0};   // Sweeps of retireOne() that found an object to retire
+    uint64_t orcCasFailures {0};   // Failed CAS on _orc
+    // These two are read from the domain by getStats()
+    uint64_t handoversInUse {0};   // Non-empty handovers
+    uint64_t maxHPs {0};
+
+    // Counters since 'before'. The maximums and the domain values are the current ones
+    OrcStats operator-(const OrcStats& before) const {
+        OrcStats d = *this;
+        d.retired -= before.retired;
+        d.deleted -= before.deleted;
+        d.handedOver -= before.handedOver;
+        d.handoverScans -= before.handoverScans;
+        d.scannedSlots -= before.scannedSlots;
+        d.retireOneSweeps -= before.retireOneSweeps;
+        d.retireOneFound -= before.retireOneFound;
+        d.orcCasFailures -= before.orcCasFailures;
+        return d;
+    }
+
+    void print(std::ostream& os) const {
+        os << "OrcGC: retired=" << retired << " deleted=" << deleted << " handedOver=" << handedOver;
+        os << " slots/scan=" << (handoverScans == 0 ? 0 : scannedSlots/handoverScans) << " maxRecursion=" << maxRecursion;
+        os << " retireOne=" << retireOneFound << "/" << retireOneSweeps << " orcCasFailures=" << orcCasFailures;
+        os << " handoversInUse=" << handoversInUse << " maxHPs=" << maxHPs << "\n";
+    }
+};
+
+
+/*
+ * Live gauge of the objects created by orc_new<T>() (make_orc<T>() and make_orc_unpublished<T>())
+ * whose _deleter has not been called yet, for each type T.
+ * Each thread counts its allocations and deletions in its own row, with a relaxed load and store
+ * instead of an atomic increment. An object is usually deleted by another thread than the one that
+ * allocated it, so only the sum of all the rows has a meaning, and when it is read while other threads
+ * are running it may be off by the few objects that are being allocated or deleted at that moment.
+ * Types get an index the first time orc_new<T>() is called for them. If there are more than MAX_TYPES,
+ * the remaining types are all counted in the last index.
+ */
+class OrcLiveObjects {
+public:
+    static const bool enabled = true;   // Set to false to remove the counting from orc_new() and the deleters
+    static const int  MAX_TYPES = 32;
+
+private:
+    struct alignas(128) Row {
+        std::atomic<uint64_t> allocated[MAX_TYPES];
+        std::atomic<uint64_t> deleted[MAX_TYPES];
+    };
+
+    Row                        rows[REGISTRY_MAX_THREADS];
+    std::atomic<const char*>   names[MAX_TYPES];
+    std::atomic<int>           numTypes {0};
+
+    static inline void inc(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+    }
+
+    int registerType(const char* mangled) {
+        const int idx = numTypes.fetch_add(1);
+        if (idx >= MAX_TYPES-1) {
+            numTypes.store(MAX_TYPES);
+            names[MAX_TYPES-1].store("other");
+            return MAX_TYPES-1;
+        }
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);  // Never freed, one per type
+        names[idx].store(status == 0 ? demangled : mangled);
+        return idx;
+    }
+
+public:
+    OrcLiveObjects() {
+        for (int it = 0; it < REGISTRY_MAX_THREADS; it++) {
+            for (int i = 0; i < MAX_TYPES; i++) {
+                rows[it].allocated[i].store(0, std::memory_order_relaxed);
+                rows[it].deleted[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        for (int i = 0; i < MAX_TYPES; i++) names[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    template<typename T> int typeIndex() {
+        static const int idx = registerType(typeid(T).name());
+        return idx;
+    }
+
+    inline void countAllocated(const int idx, const int tid) { inc(rows[tid].allocated[idx]); }
+
+    inline void countDeleted(const int idx, const int tid) { inc(rows[tid].deleted[idx]); }
+
+    int getNumTypes() const { return std::min(numTypes.load(), MAX_TYPES); }
+
+    // May return nullptr while the type is being registered
+    const char* getTypeName(const int idx) const { return names[idx].load(); }
+
+    // Objects of the type 'idx' that are currently allocated
+    int64_t getLive(const int idx) const {
+        int64_t sum = 0;
+        const int maxThreads = (int)ThreadRegistry::getMaxThreads();
+        for (int it = 0; it < maxThreads; it++) {
+            sum += rows[it].allocated[idx].load(std::memory_order_relaxed);
+            sum -= rows[it].deleted[idx].load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    int64_t getTotalLive() const {
+        int64_t sum = 0;
+        for (int i = 0; i < getNumTypes(); i++) sum += getLive(i);
+        return sum;
+    }
+};
+
+// Shared by all the domains, because the types are not specific to a domain
+OrcLiveObjects g_orc_live {};
+
+
+/*
+ * Objects that a PassThePointerOrcGC domain currently holds without having deleted them yet,
+ * as returned by getGauge(). Unlike OrcStats, these are always available.
+ * The handovers can never hold more than 'bound' objects, which is the memory bound of OrcGC
+ * (number of threads times the hazardous pointers in use), not counting the objects that they
+ * keep reachable through their links.
+ */
+struct OrcGauge {
+    uint64_t handovers {0};   // Objects in handovers[][]
+    uint64_t bound {0};       // Registered threads * maxHPs
+    uint64_t recursive {0};   // Objects added to the recursiveLists by the retire() calls that are in progress
+};
+
 
 // Hazard Pointers class made specifically to be used by OrcGC
 class PassThePointerOrcGC  {
 
 private:
     static const int      MAX_HAZ = 64;        // This is named 'K' in the HP paper
-    static const int      CLPAD = 128/sizeof(uintptr_t);
+    static const bool     useVectorScan = true;  // Look for candidate slots with hpscan_find() (see HPScan.hpp)
     bool                  inDestructor = false;
     // Stuff that is thread specific and is therefore indexed by thread id in tl[]
     struct TLInfo {
@@ -89,6 +257,8 @@ private:
         std::vector<orc_base*>  recursiveList;
         int                     usedHaz[MAX_HAZ];  // Which hp indexes are being used by the thread.
         int                     retcnt {0};
+        OrcStats                stats {};
+        std::atomic<uint64_t>   recursiveSize {0};  // Size of recursiveList, for getGauge()
         uint8_t                 pad[128];
         TLInfo() {
             for (int ihe = 0; ihe < MAX_HAZ; ihe++) usedHaz[ihe] = 0;
@@ -96,8 +266,15 @@ private:
         }
     };
 
+    // One row of hazardous pointers per thread. The row's high-water mark shares the first cache line with hps[0..14],
+    // so that scanning a row whose thread uses few hps costs a single cache line, like before the mark existed.
+    struct alignas(128) HPRow {
+        std::atomic<uint64_t>   maxHPs {1};        // Same as maxHPs but for this row. Index 0 is used without calling getNewIdx()
+        std::atomic<orc_base*>  hps[MAX_HAZ];
+    };
+
     // Class members
-    alignas(128) std::atomic<orc_base*>   hp[REGISTRY_MAX_THREADS][MAX_HAZ];
+    HPRow                                 hp[REGISTRY_MAX_THREADS];
     alignas(128) std::atomic<orc_base*>   handovers[REGISTRY_MAX_THREADS][MAX_HAZ];
     alignas(128) std::atomic<uint64_t>    maxHPs {0};                 // Optimization so that retire() doesn't have to scan MAX_HAZ everytime
     alignas(128) TLInfo                   tl[REGISTRY_MAX_THREADS];   // Thread-local stuff. One entry per thread
@@ -106,7 +283,7 @@ public:
     PassThePointerOrcGC() {
         for (int it = 0; it < REGISTRY_MAX_THREADS; it++) {
             for (int ihp = 0; ihp < MAX_HAZ; ihp++) {
-                hp[it][ihp].store(nullptr, std::memory_order_relaxed);
+                hp[it].hps[ihp].store(nullptr, std::memory_order_relaxed);
                 handovers[it][ihp].store(nullptr, std::memory_order_relaxed);
             }
         }
@@ -124,10 +301,8 @@ public:
             for (int ihp = 0; ihp < lmaxHPs; ihp++) {
                 orc_base* obj = handovers[it][ihp].load();
                 if (obj == nullptr) continue;
-                uint64_t lorc = obj->_orc.load();
                 handovers[it][ihp].store(nullptr, std::memory_order_relaxed);
                 retire(obj,tid);
-
             }
         }
         //printf("maxHPs = %ld\n", maxHPs.load());
@@ -141,16 +316,73 @@ public:
         tl[tid].retcnt = 0;
     }
 
+    // Called by orc_atomic when a CAS on _orc fails
+    inline void statOrcCasFailure(const int tid) {
+        if (OrcStats::enabled) tl[tid].stats.orcCasFailures++;
+    }
+
+    // Sum of the statistics of all threads. See OrcStats
+    OrcStats getStats() {
+        OrcStats sum {};
+        const int maxThreads = (int)ThreadRegistry::getMaxThreads();
+        for (int it = 0; it < maxThreads; it++) {
+            const OrcStats& st = tl[it].stats;
+            sum.retired += st.retired;
+            sum.deleted += st.deleted;
+            sum.handedOver += st.handedOver;
+            sum.handoverScans += st.handoverScans;
+            sum.scannedSlots += st.scannedSlots;
+            sum.maxRecursion = std::max(sum.maxRecursion, st.maxRecursion);
+            sum.retireOneSweeps += st.retireOneSweeps;
+            sum.retireOneFound += st.retireOneFound;
+            sum.orcCasFailures += st.orcCasFailures;
+            for (int ihp = 0; ihp < MAX_HAZ; ihp++) {
+                if (handovers[it][ihp].load(std::memory_order_relaxed) != nullptr) sum.handoversInUse++;
+            }
+        }
+        sum.maxHPs = maxHPs.load();
+        return sum;
+    }
+
+    // Must not be called while other threads use this domain
+    void resetStats() {
+        for (int it = 0; it < REGISTRY_MAX_THREADS; it++) tl[it].stats = OrcStats{};
+    }
+
+    // Can be called at any time, by any thread. See OrcGauge
+    OrcGauge getGauge() {
+        OrcGauge g {};
+        const int maxThreads = (int)ThreadRegistry::getMaxThreads();
+        const int lmaxHPs = maxHPs.load(std::memory_order_acquire);
+        for (int it = 0; it < maxThreads; it++) {
+            const int found = hpscan_find_not(handovers[it], lmaxHPs, nullptr);
+            if (found >= 0) {
+                for (int ihp = found; ihp < lmaxHPs; ihp++) {
+                    if (handovers[it][ihp].load(std::memory_order_relaxed) != nullptr) g.handovers++;
+                }
+            }
+            g.recursive += tl[it].recursiveSize.load(std::memory_order_relaxed);
+        }
+        g.bound = maxThreads * lmaxHPs;
+        return g;
+    }
+
     // Returns the next available he index for this thread, and updates maxHEs if needed
     // TODO: consider optimizing by looking up if the ptr already exists and if yes, return the index (and increment the usedHaz)
     int getNewIdx(const int tid, int start_idx=1) {
         for (int idx = start_idx; idx < MAX_HAZ; idx++) {
             if (tl[tid].usedHaz[idx] != 0) continue;
             tl[tid].usedHaz[idx]++;
-            // Increase the current maximum to cover the new hp index
-            uint64_t curMax = maxHPs.load(std::memory_order_relaxed);
-            while (curMax <= idx) {
-                maxHPs.compare_exchange_strong(curMax, idx+1);
+            // Increase the maximum of this thread's row to cover the new hp index.
+            // Only this thread writes to its row, therefore a seq_cst store is enough.
+            // This must be visible before the hp is published, just like maxHPs.
+            if (hp[tid].maxHPs.load(std::memory_order_relaxed) <= (uint64_t)idx) {
+                hp[tid].maxHPs.store(idx+1);
+                // Increase the current maximum to cover the new hp index
+                uint64_t curMax = maxHPs.load(std::memory_order_relaxed);
+                while (curMax <= (uint64_t)idx) {
+                    maxHPs.compare_exchange_strong(curMax, idx+1);
+                }
             }
             return idx;
         }
@@ -187,6 +419,7 @@ public:
             uint64_t lorc = ptr->_orc.load(std::memory_order_acquire);
             if (ocnt(lorc) == ORC_ZERO) {
                 if (ptr->_orc.compare_exchange_strong(lorc, lorc+BRETIRED)) retire(ptr, tid);
+                else statOrcCasFailure(tid);
             }
         }
     }
@@ -200,9 +433,9 @@ public:
         T pub, ptr = nullptr;
         while ((pub=addr->load()) != ptr) {
 #ifdef ALWAYS_USE_EXCHANGE
-            hp[tid][index].exchange(getUnmarked(pub));
+            hp[tid].hps[index].exchange(getUnmarked(pub));
 #else
-            hp[tid][index].store(getUnmarked(pub));
+            hp[tid].hps[index].store(getUnmarked(pub));
 #endif
             ptr = pub;
         }
@@ -213,7 +446,7 @@ public:
     // Notice that the store here is done with memory_order_release, while on get_protected() it is done with memory_order_seq_cst or equivalent.
     // Progress Condition: wait-free population-oblivious
     inline void protect_ptr(orc_base* ptr, const int tid, int index) {
-        hp[tid][index].store(getUnmarked(ptr), std::memory_order_release);
+        hp[tid].hps[index].store(getUnmarked(ptr), std::memory_order_release);
     }
 
     /**
@@ -227,21 +460,33 @@ public:
 
     void retire(orc_base* ptr, int tid) {
         if (ptr == nullptr) return;
+        if (OrcStats::enabled) tl[tid].stats.retired++;
         auto& rlist = tl[tid].recursiveList;
         // We don't want to blow up the program's stack, therefore, if this is being called recursively,
         // just add the ptr to the recursiveList and return.
         if (tl[tid].retireStarted) {
             rlist.push_back(ptr);
+            tl[tid].recursiveSize.store(rlist.size(), std::memory_order_relaxed);
             return;
         }
         // If this is being called from the destructor ~PassThePointerOrcGC(), clear out the handovers so we don't leak anything
         if (!inDestructor) {
-            const int lmaxHPs = maxHPs.load(std::memory_order_acquire);
-            for (int i=0;i<lmaxHPs;i++){
-                // there is at least one hp with ptr published
-                if (hp[tid][i].load(std::memory_order_relaxed) == ptr) {
+            const int lmaxHPs = hp[tid].maxHPs.load(std::memory_order_acquire);
+            if (useVectorScan) {
+                // These are our own hps, there is no need to re-check
+                const int i = hpscan_find(hp[tid].hps, lmaxHPs, ptr);
+                if (i >= 0) {
                     ptr = handovers[tid][i].exchange(ptr);
-                    break;
+                    if (OrcStats::enabled) tl[tid].stats.handedOver++;
+                }
+            } else {
+                for (int i=0;i<lmaxHPs;i++){
+                    // there is at least one hp with ptr published
+                    if (hp[tid].hps[i].load(std::memory_order_relaxed) == ptr) {
+                        ptr = handovers[tid][i].exchange(ptr);
+                        if (OrcStats::enabled) tl[tid].stats.handedOver++;
+                        break;
+                    }
                 }
             }
         }
@@ -253,7 +498,7 @@ public:
                 if (!isCounterZero(lorc)){
                 	if((lorc = clearBitRetired(ptr,tid))==0) break;
                 }
-                if (tryHandover(ptr)) continue;
+                if (tryHandover(ptr, tid)) continue;
                 uint64_t lorc2 = ptr->_orc.load(std::memory_order_acquire);
                 if (lorc2 != lorc) {
                     if(!isCounterZero(lorc2)){
@@ -262,6 +507,7 @@ public:
                     continue;
                 }
                 (*(ptr->_deleter))(ptr);  // This calls "delete obj" with the appropriate type information
+                if (OrcStats::enabled) tl[tid].stats.deleted++;
                 break;
             }
             if(rlist.size()==i) break;
@@ -269,18 +515,22 @@ public:
             i++;
         }
         assert(i== rlist.size());
+        if (OrcStats::enabled && rlist.size() > tl[tid].stats.maxRecursion) tl[tid].stats.maxRecursion = rlist.size();
         rlist.clear();
+        tl[tid].recursiveSize.store(0, std::memory_order_relaxed);
         tl[tid].retireStarted = false;
     }
 
     uint64_t clearBitRetired(orc_base* ptr, int tid) {
-    	hp[tid][0].store(static_cast<orc_base*>(ptr), std::memory_order_release);
+    	hp[tid].hps[0].store(static_cast<orc_base*>(ptr), std::memory_order_release);
     	uint64_t lorc = ptr->_orc.fetch_add(-BRETIRED)-BRETIRED;
-		if(ocnt(lorc) == ORC_ZERO && ptr->_orc.compare_exchange_strong(lorc, lorc+BRETIRED)){
-			hp[tid][0].store(nullptr, std::memory_order_relaxed);
+		const bool isZero = (ocnt(lorc) == ORC_ZERO);
+		if(isZero && ptr->_orc.compare_exchange_strong(lorc, lorc+BRETIRED)){
+			hp[tid].hps[0].store(nullptr, std::memory_order_relaxed);
 			return lorc+BRETIRED;// counter is zero, we can proceed to check HPs
 		}else{
-			hp[tid][0].store(nullptr, std::memory_order_relaxed);
+			if (isZero) statOrcCasFailure(tid);
+			hp[tid].hps[0].store(nullptr, std::memory_order_relaxed);
 			return 0;
 		}
     }
@@ -289,12 +539,20 @@ public:
     // Search for _one_ object to retire
     // Called only from decrementOrc(). Must be 'public'.
     void retireOne(int tid) {
-        const int lmaxHPs = maxHPs.load(std::memory_order_acquire);
+        if (OrcStats::enabled) tl[tid].stats.retireOneSweeps++;
+        const int lmaxHPs = hp[tid].maxHPs.load(std::memory_order_acquire);
         for (int idx = 0; idx < lmaxHPs; idx++) {
+            // Skip over the empty handovers
+            if (useVectorScan) {
+                const int found = hpscan_find_not(&handovers[tid][idx], lmaxHPs - idx, nullptr);
+                if (found < 0) break;
+                idx += found;
+            }
             // Find an obj to delete in my handovers list
             orc_base* obj = handovers[tid][idx].load(std::memory_order_relaxed);
-            if (obj != nullptr && obj != hp[tid][idx].load(std::memory_order_relaxed)){
+            if (obj != nullptr && obj != hp[tid].hps[idx].load(std::memory_order_relaxed)){
                 obj = handovers[tid][idx].exchange(nullptr);
+                if (OrcStats::enabled) tl[tid].stats.retireOneFound++;
                 retire(obj,tid);
                 return;
             }
@@ -303,10 +561,17 @@ public:
         const int maxThreads = (int)ThreadRegistry::getMaxThreads();
         for (int id = 0; id < maxThreads; id++) {
             if (id == tid) continue; // Already scanned my own list
-            for (int idx = 0; idx < lmaxHPs; idx++) {
+            const int rmaxHPs = hp[id].maxHPs.load(std::memory_order_acquire);
+            for (int idx = 0; idx < rmaxHPs; idx++) {
+                if (useVectorScan) {
+                    const int found = hpscan_find_not(&handovers[id][idx], rmaxHPs - idx, nullptr);
+                    if (found < 0) break;
+                    idx += found;
+                }
                 orc_base* obj = handovers[id][idx].load(std::memory_order_acquire);
-                if (obj != nullptr && obj != hp[id][idx].load(std::memory_order_acquire)) {
+                if (obj != nullptr && obj != hp[id].hps[idx].load(std::memory_order_acquire)) {
                     obj = handovers[id][idx].exchange(nullptr);
+                    if (OrcStats::enabled) tl[tid].stats.retireOneFound++;
                     retire(obj,tid);
                     return;
                 }
@@ -318,14 +583,27 @@ public:
 private:
 
     // Called only from retire()
-    inline bool tryHandover(orc_base*& ptr) {
+    // Each row is scanned only up to the highest hp index that its thread has ever used, which
+    // means threads that do not use this domain (or use few orc_ptr) cost a single load.
+    // An index is accounted for in hp[].maxHPs before getNewIdx() returns it, and therefore before
+    // anything is published on it, so a pointer published in hp[tid].hps[idx] is never missed.
+    inline bool tryHandover(orc_base*& ptr, const int mytid) {
         if (inDestructor) return false;
         const int maxThreads = (int)ThreadRegistry::getMaxThreads();
-        const int lmaxHPs = maxHPs.load(std::memory_order_acquire);
+        if (OrcStats::enabled) tl[mytid].stats.handoverScans++;
         for (int tid = 0; tid < maxThreads; tid++) {
+            const int lmaxHPs = hp[tid].maxHPs.load(std::memory_order_acquire);
+            if (OrcStats::enabled) tl[mytid].stats.scannedSlots += lmaxHPs;
             for (int idx = 0; idx < lmaxHPs; idx++) {
-                if (ptr == hp[tid][idx].load(std::memory_order_acquire)) {
+                if (useVectorScan) {
+                    // Skip ahead to the next slot that may have 'ptr'. It is re-checked below with a load()
+                    const int found = hpscan_find(&hp[tid].hps[idx], lmaxHPs - idx, ptr);
+                    if (found < 0) break;
+                    idx += found;
+                }
+                if (ptr == hp[tid].hps[idx].load(std::memory_order_acquire)) {
                     ptr = handovers[tid][idx].exchange(ptr);
+                    if (OrcStats::enabled) tl[mytid].stats.handedOver++;
                     return true;
                 }
             }
@@ -338,14 +616,15 @@ public:
     template<typename T> T getUnmarked(T ptr) { return (T)(((size_t)ptr) & (~0x3ULL)); }
 };
 
-// The global/singleton instance of PassThePointer
+// The global/singleton instance of PassThePointer. This is the default domain.
 PassThePointerOrcGC g_ptp {};
 
 
 
 // Temporary object that comes from a load().
 // Do NOT use in user code. This is meant to be used internally only.
-template<typename T>
+// 'domain' is where the pointer was protected, it can only be turned into an orc_ptr of the same domain.
+template<typename T, PassThePointerOrcGC& domain = g_ptp>
 struct orc_unsafe_internal_ptr {
     T ptr;
 
@@ -359,9 +638,9 @@ struct orc_unsafe_internal_ptr {
     inline bool getTag() const { return (bool)((size_t)ptr & 2); }
 
     // Equality/Inequality operators
-    bool operator == (const orc_unsafe_internal_ptr<T> &rhs) { return ptr == rhs.ptr; }
+    bool operator == (const orc_unsafe_internal_ptr<T,domain> &rhs) { return ptr == rhs.ptr; }
     bool operator == (const T &rhs) { return ptr == rhs; }
-    bool operator != (const orc_unsafe_internal_ptr<T> &rhs) { return ptr != rhs.ptr; }
+    bool operator != (const orc_unsafe_internal_ptr<T,domain> &rhs) { return ptr != rhs.ptr; }
     bool operator != (const T &rhs) { return ptr != rhs; }
 };
 
@@ -394,7 +673,7 @@ struct orc_unsafe_internal_ptr {
 // Calls: copy constructor (internal-to-internal), copy constructor (internal-to-orc)
 //
 
-template<typename T> struct orc_ptr {
+template<typename T, PassThePointerOrcGC& domain = g_ptp> struct orc_ptr {
     T       ptr;
     int16_t tid;
     int8_t  idx;
@@ -406,12 +685,12 @@ template<typename T> struct orc_ptr {
     // Default constructor. ptr will be nullptr
     orc_ptr() : lnk{true} {
         tid = ThreadRegistry::getTID();
-        idx = g_ptp.getNewIdx(tid);
+        idx = domain.getNewIdx(tid);
         ptr = nullptr;
     }
 
     ~orc_ptr() {
-        g_ptp.clear(ptr, idx, tid, lnk, false);
+        domain.clear(ptr, idx, tid, lnk, false);
     }
 
     // Used by Natarajan and maybe Harris
@@ -421,7 +700,7 @@ template<typename T> struct orc_ptr {
     inline bool getFlag() const { return (bool)((size_t)ptr & 1); }
     inline bool getTag() const { return (bool)((size_t)ptr & 2); }
     inline void unmark() { ptr = getUnmarked(); }
-    inline void swapPtrs(orc_ptr<T>& other) {
+    inline void swapPtrs(orc_ptr<T,domain>& other) {
         T tmp_ptr = ptr;
         int8_t tmp_idx = idx;
         ptr = other.ptr;
@@ -431,8 +710,8 @@ template<typename T> struct orc_ptr {
     }
 
     // Equality/Inequality operators
-    bool operator == (const orc_unsafe_internal_ptr<T> &rhs) { return ptr == rhs.ptr; }
-    bool operator != (const orc_unsafe_internal_ptr<T> &rhs) { return ptr != rhs.ptr; }
+    bool operator == (const orc_unsafe_internal_ptr<T,domain> &rhs) { return ptr == rhs.ptr; }
+    bool operator != (const orc_unsafe_internal_ptr<T,domain> &rhs) { return ptr != rhs.ptr; }
     bool operator == (const T &rhs) { return ptr == rhs; }
     bool operator != (const T &rhs) { return ptr != rhs; }
 
@@ -451,7 +730,7 @@ template<typename T> struct orc_ptr {
 
     // Copy constructor (orc-to-orc)
     orc_ptr(const orc_ptr& other) {
-        PassThePointerOrcGC* ptp = &g_ptp;
+        PassThePointerOrcGC* ptp = &domain;
         tid = other.tid;
         idx = other.idx;
         ptr = other.ptr;
@@ -465,12 +744,12 @@ template<typename T> struct orc_ptr {
     }
 
     // Copy constructor (internal-to-orc)
-    orc_ptr(const orc_unsafe_internal_ptr<T>& other) {
+    orc_ptr(const orc_unsafe_internal_ptr<T,domain>& other) {
         tid = ThreadRegistry::getTID();
-        idx = g_ptp.getNewIdx(tid);
+        idx = domain.getNewIdx(tid);
         ptr = other.ptr;
         lnk = true;
-        g_ptp.protect_ptr(ptr, tid, idx);
+        domain.protect_ptr(ptr, tid, idx);
     }
 
     // Copy constructor with move semantics (orc-to-orc)
@@ -481,8 +760,8 @@ template<typename T> struct orc_ptr {
         ptr = other.ptr;
         lnk = other.lnk;
         if (idx == 0) {
-            idx = g_ptp.getNewIdx(tid);
-            g_ptp.protect_ptr(ptr, tid, idx);
+            idx = domain.getNewIdx(tid);
+            domain.protect_ptr(ptr, tid, idx);
         } else {
             // other.idx is always 0, it should never enter this branch
             other.idx = 0;
@@ -493,7 +772,7 @@ template<typename T> struct orc_ptr {
     // We decrement the counter (and clear the hp if there is no other orc_ptr
     // with the same idx) and increment the counter for the other orc_ptr.
     inline orc_ptr& operator=(const orc_ptr& other) {
-        PassThePointerOrcGC* ptp = &g_ptp;
+        PassThePointerOrcGC* ptp = &domain;
         bool reuseIdx = ((other.idx < idx) && (ptp->getUsedHaz(idx, tid) == 1));
         ptp->clear(ptr, idx, tid, lnk, reuseIdx);
         if (other.idx < idx) {
@@ -510,7 +789,7 @@ template<typename T> struct orc_ptr {
 
     // Move assignment operator (orc-to-orc)
     inline orc_ptr& operator=(orc_ptr&& other) {
-        PassThePointerOrcGC* ptp = &g_ptp;
+        PassThePointerOrcGC* ptp = &domain;
         bool reuseIdx = ((other.idx < idx) && (ptp->getUsedHaz(idx, tid) == 1));
         ptp->clear(ptr, idx, tid, lnk, reuseIdx);
         if (other.idx < idx) {
@@ -528,13 +807,13 @@ template<typename T> struct orc_ptr {
 
     // Move assignment (internal-to-orc)
     //other comes always from a load and other.idx is 0
-    inline orc_ptr& operator=(orc_unsafe_internal_ptr<T>&& other) {
+    inline orc_ptr& operator=(orc_unsafe_internal_ptr<T,domain>&& other) {
         // This may be called once or twice. If called twice, 'other' is the just-moved-from orc_ptr hp
         //printf("orc_ptr 'move' from %p to %p increment on idx=%d\n", ptr, other.ptr, other.idx);
-        bool reuseIdx = (g_ptp.getUsedHaz(idx, tid) == 1);
-        g_ptp.clear(ptr, idx, tid, lnk, reuseIdx);
-        if (!reuseIdx) idx = g_ptp.getNewIdx(tid);
-        g_ptp.protect_ptr(other.ptr, tid, idx);
+        bool reuseIdx = (domain.getUsedHaz(idx, tid) == 1);
+        domain.clear(ptr, idx, tid, lnk, reuseIdx);
+        if (!reuseIdx) idx = domain.getNewIdx(tid);
+        domain.protect_ptr(other.ptr, tid, idx);
         ptr = other.ptr;
         lnk = true;
         return *this;
@@ -542,8 +821,8 @@ template<typename T> struct orc_ptr {
 
     // Used by Harris Original and Maged-Harris
     // TODO: change this to return orc_unsafe_internal_ptr<T> instead.
-    T setUnmarked(orc_ptr<T>& other) {
-        PassThePointerOrcGC* ptp = &g_ptp;
+    T setUnmarked(orc_ptr<T,domain>& other) {
+        PassThePointerOrcGC* ptp = &domain;
         bool reuseIdx = ((other.idx < idx) && (ptp->getUsedHaz(idx, tid) == 1));
         ptp->clear(ptr, idx, tid, lnk, reuseIdx);
         if(other.idx<idx){
@@ -553,22 +832,22 @@ template<typename T> struct orc_ptr {
             ptp->usingIdx(other.idx, tid);
             idx = other.idx;
         }
-        ptr = g_ptp.getUnmarked(other.ptr);
+        ptr = domain.getUnmarked(other.ptr);
         lnk = other.lnk;
         return ptr;
     }
 
     // Used by Harris Original and Maged-Harris
     // TODO: change this to return orc_unsafe_internal_ptr<T> instead.
-    T setUnmarked(orc_unsafe_internal_ptr<T>&& other) {
-        PassThePointerOrcGC* ptp = &g_ptp;
+    T setUnmarked(orc_unsafe_internal_ptr<T,domain>&& other) {
+        PassThePointerOrcGC* ptp = &domain;
         bool reuseIdx = (ptp->getUsedHaz(idx, tid) == 1);
         if (!reuseIdx) {
         	ptp->clear(ptr, idx, tid, lnk, reuseIdx);
         	idx = ptp->getNewIdx(tid, 1);
         }
         ptp->protect_ptr(other.ptr, tid, idx);
-        ptr = g_ptp.getUnmarked(other.ptr);
+        ptr = domain.getUnmarked(other.ptr);
         lnk = true;
         return ptr;
     }
@@ -577,17 +856,70 @@ template<typename T> struct orc_ptr {
 
 
 
+// Allocates and constructs a T, from the thread's OrcPool<T> if g_orc_pool_enabled is set
+// and counts it in g_orc_live
+template <typename T, typename... Args>
+T* orc_new(const int tid, Args&&... args) {
+    T* ptr;
+    if (OrcPool<T>::fits && g_orc_pool_enabled) {
+        ptr = new (OrcPool<T>::allocate(tid)) T(std::forward<Args>(args)...);
+        ptr->_deleter = [](void* obj) {
+            const int dtid = ThreadRegistry::getTID();
+            static_cast<T*>(obj)->~T();
+            OrcPool<T>::deallocate(obj, dtid);
+            if (OrcLiveObjects::enabled) g_orc_live.countDeleted(g_orc_live.typeIndex<T>(), dtid);
+        };
+    } else {
+        ptr = new T(std::forward<Args>(args)...);
+        ptr->_deleter = [](void* obj) {
+            delete static_cast<T*>(obj);
+            if (OrcLiveObjects::enabled) g_orc_live.countDeleted(g_orc_live.typeIndex<T>(), ThreadRegistry::getTID());
+        };
+    }
+    if (OrcLiveObjects::enabled) g_orc_live.countAllocated(g_orc_live.typeIndex<T>(), tid);
+    return ptr;
+}
+
 /*
  * make_orc<T> is similar to make_shared<T>
+ * If g_orc_pool_enabled is set, the memory comes from the thread's OrcPool<T> (see OrcPool.hpp)
+ * make_orc<T,domain> creates the orc_ptr in another domain than g_ptp
  */
-template <typename T, typename... Args>
-orc_ptr<T*> make_orc(Args&&... args) {
+template <typename T, PassThePointerOrcGC& domain = g_ptp, typename... Args>
+orc_ptr<T*,domain> make_orc(Args&&... args) {
     const int tid = ThreadRegistry::getTID();
-    T* ptr = new T(std::forward<Args>(args)...);
-    ptr->_deleter = [](void* obj) { delete static_cast<T*>(obj); };
-    g_ptp.protect_ptr(ptr, tid, 0);
+    T* ptr = orc_new<T>(tid, std::forward<Args>(args)...);
+    domain.protect_ptr(ptr, tid, 0);
     // If the orc_ptr was created by the user, then it is not linked
-    return std::move(orc_ptr<T*>(ptr, tid, 0, false));
+    return std::move(orc_ptr<T*,domain>(ptr, tid, 0, false));
+}
+
+/*
+ * For bulk construction (see common/BulkLoad.hpp): creates an object that no other thread can see yet,
+ * without a hazardous pointer, and with its counter already set to the number of links that will point
+ * to it, so that each link can be stored with orc_atomic<T>::init() instead of an atomic increment.
+ * Until it is published, it is up to the caller to keep the object reachable from an orc_ptr, otherwise
+ * it will never be reclaimed.
+ * make_orc_unpublished<T,domain> is for the objects of another domain than g_ptp, which are linked and
+ * retired through that domain once they are published.
+ */
+template <typename T, PassThePointerOrcGC& domain = g_ptp, typename... Args>
+T* make_orc_unpublished(const uint64_t links, Args&&... args) {
+    T* ptr = orc_new<T>(ThreadRegistry::getTID(), std::forward<Args>(args)...);
+    ptr->_orc.store(ORC_ZERO + links, std::memory_order_relaxed);
+    return ptr;
+}
+
+/*
+ * Same as make_orc<T> but for an object that was constructed by the caller and has its own _deleter,
+ * for example an object that is being reused instead of freed (see LCRQueueOrcGC). Its counter must be
+ * at ORC_ZERO and no other thread may be able to see it yet. It is not counted in g_orc_live.
+ */
+template <PassThePointerOrcGC& domain = g_ptp, typename T>
+orc_ptr<T*,domain> orc_adopt(T* ptr) {
+    const int tid = ThreadRegistry::getTID();
+    domain.protect_ptr(ptr, tid, 0);
+    return std::move(orc_ptr<T*,domain>(ptr, tid, 0, false));
 }
 
 
@@ -600,7 +932,7 @@ template<typename T> bool is_poisoned(T ptr) { return (void*)ptr.getUnmarked() =
 
 
 // 'T' is typically 'Node*'
-template<typename T>
+template<typename T, PassThePointerOrcGC& domain = g_ptp>
 class orc_atomic : public std::atomic<T> {
 private:
     static const bool enablePoison = true;  // set to false to disable poisoning
@@ -615,7 +947,8 @@ private:
         uint64_t lorc = ptr->_orc.fetch_add(1) + 1;
         if (ocnt(lorc) != ORC_ZERO) return;
         // No need to increment sequence: the faa has done it already
-        if (ptr->_orc.compare_exchange_strong(lorc, lorc + BRETIRED)) g_ptp.retire(ptr);
+        if (ptr->_orc.compare_exchange_strong(lorc, lorc + BRETIRED)) domain.retire(ptr);
+        else domain.statOrcCasFailure(ThreadRegistry::getTID());
     }
 
     /*
@@ -628,15 +961,16 @@ private:
         ptr = getUnmarked(ptr);
         if (ptr == nullptr || ptr == (T)&g_poisoned) return;
         const int tid = ThreadRegistry::getTID();
-        g_ptp.protect_ptr(ptr, tid, 0);
+        domain.protect_ptr(ptr, tid, 0);
         uint64_t lorc = ptr->_orc.fetch_add(ORC_SEQ-1) + ORC_SEQ - 1;
-        if (g_ptp.addRetcnt(tid) == MAX_RETCNT) {
-            g_ptp.retireOne(tid);
-            g_ptp.resetRetcnt(tid);
+        if (domain.addRetcnt(tid) == MAX_RETCNT) {
+            domain.retireOne(tid);
+            domain.resetRetcnt(tid);
         }
         if (ocnt(lorc) != ORC_ZERO) return;
         // No need to increment sequence: the faa has done it already
-        if (ptr->_orc.compare_exchange_strong(lorc, lorc + BRETIRED)) g_ptp.retire(ptr, tid);
+        if (ptr->_orc.compare_exchange_strong(lorc, lorc + BRETIRED)) domain.retire(ptr, tid);
+        else domain.statOrcCasFailure(tid);
     }
 
 public:
@@ -659,21 +993,21 @@ public:
     }
 
     // Operator arrow.  Let's us do 'ptr = oatom_a->oatom_b->otaom_c' instead of 'ptr = oatom_.load()->oatom_b.load()->oatom_c.load'
-    orc_ptr<T> operator->() { return load(); }
+    orc_ptr<T,domain> operator->() { return load(); }
 
     // Casting operator. Let's us do 'ptr = oatom' instead of 'ptr = oatom.load()'
-    operator orc_ptr<T>() { return load(); }
+    operator orc_ptr<T,domain>() { return load(); }
 
     // Assignment operator from a desired value. Let's us do 'oatom = ptr' instead of 'oatm.store(ptr)'
-    orc_atomic<T>& operator=(T desired) {
+    orc_atomic<T,domain>& operator=(T desired) {
         store(desired);
         return *this;
     }
 
     // Assignment operator from another orc_atomic. Let's us do 'oatom = atom' instead of 'oatm.store(atom.load())'
-    orc_atomic<T>& operator=(orc_atomic<T>& atom) {
+    orc_atomic<T,domain>& operator=(orc_atomic<T,domain>& atom) {
         // TODO: can we optimize this?
-        orc_ptr<T> newval = atom.load();
+        orc_ptr<T,domain> newval = atom.load();
         store(newval);
         return *this;
     }
@@ -690,14 +1024,24 @@ public:
         decrementOrc(old);
     }
 
+    // Same as store(), for a link that only the calling thread can change and whose current value is 'old'.
+    // The link is written with a plain store instead of an exchange(). The counters are updated like in store(),
+    // and there is nothing to decrement when 'old' is nullptr.
+    // Progress: Wait-free (population oblivious)
+    inline void storeOwned(T newval, T old, std::memory_order order = std::memory_order_release) {
+        incrementOrc(newval);
+        std::atomic<T>::store(newval, order);
+        decrementOrc(old);
+    }
+
     // This is currently not being used by any data structure, but we implemented it anyways
     // Progress: Wait-free (population oblivious)
-    inline orc_unsafe_internal_ptr<T> exchange(T newval) {
+    inline orc_unsafe_internal_ptr<T,domain> exchange(T newval) {
         incrementOrc(newval);
         T old = std::atomic<T>::exchange(newval);
         decrementOrc(old);
         const int tid = ThreadRegistry::getTID();
-        return std::move(orc_unsafe_internal_ptr<T>{old});
+        return std::move(orc_unsafe_internal_ptr<T,domain>{old});
     }
 
     // Warning: unlike std::atomic<T>::cas() the param 'expected' will not be updated
@@ -719,19 +1063,25 @@ public:
     }
 
     // Progress: Lock-Free
-    inline orc_unsafe_internal_ptr<T> load(std::memory_order order = std::memory_order_seq_cst) {
+    inline orc_unsafe_internal_ptr<T,domain> load(std::memory_order order = std::memory_order_seq_cst) {
         const int tid = ThreadRegistry::getTID();
-        auto ptr = static_cast<T>(g_ptp.get_protected(0, this, tid));
+        auto ptr = static_cast<T>(domain.get_protected(0, this, tid));
         // If it's coming from an orc_atomic<T>::load() then it must be linked=true and temp=true
-        return std::move(orc_unsafe_internal_ptr<T>{ptr});
+        return std::move(orc_unsafe_internal_ptr<T,domain>{ptr});
     }
 
     // Same as above, but creates an orc_ptr<T> without the marked bit. Used by Sundel-Tsigas
-    inline orc_unsafe_internal_ptr<T> loadUnmarked(std::memory_order order = std::memory_order_seq_cst) {
+    inline orc_unsafe_internal_ptr<T,domain> loadUnmarked(std::memory_order order = std::memory_order_seq_cst) {
         const int tid = ThreadRegistry::getTID();
-        auto ptr = static_cast<T>(g_ptp.get_protected(0, this, tid));
+        auto ptr = static_cast<T>(domain.get_protected(0, this, tid));
         // If it's coming from an orc_atomic<T>::load() then it must be linked=true and temp=true
-        return std::move(orc_unsafe_internal_ptr<T>{getUnmarked(ptr)});
+        return std::move(orc_unsafe_internal_ptr<T,domain>{getUnmarked(ptr)});
+    }
+
+    // Stores 'ptr' without incrementing its counter, which must already account for this link.
+    // Only for objects that no other thread can see yet, see make_orc_unpublished()
+    inline void init(T ptr) {
+        std::atomic<T>::store(ptr, std::memory_order_relaxed);
     }
 
     // This assumes no other thread will change the value after poisoned
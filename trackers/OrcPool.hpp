@@ -0,0 +1,259 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+#include "common/ThreadRegistry.hpp"
+
+
+namespace orcgc_ptp {
+
+// When true, make_orc<T>() takes memory from OrcPool<T> instead of calling 'new'
+bool g_orc_pool_enabled = false;
+
+// When true, the slabs of OrcPool<T> are taken from g_orc_hugepage_arena instead of aligned_alloc()
+bool g_orc_pool_hugepages = false;
+
+
+/*
+ * Source of slabs backed by 2MB huge pages.
+ *
+ * Each thread maps its own 2MB regions and cuts them into slabs, so there is no synchronization.
+ * A region is first requested as an explicit huge page (MAP_HUGETLB), which needs pages reserved
+ * in /proc/sys/vm/nr_hugepages. If there are none, a 2MB aligned region is mapped and marked with
+ * madvise(MADV_HUGEPAGE) so that it can be backed by a transparent huge page.
+ * Like the slabs, the regions are never unmapped.
+ */
+class OrcHugePageArena {
+
+private:
+    static const uint64_t REGION_SIZE = 2*1024*1024;
+
+    struct Region {
+        char*   cur {nullptr};
+        char*   end {nullptr};
+        uint8_t pad[128-2*sizeof(char*)];
+    };
+
+    alignas(128) Region regions[REGISTRY_MAX_THREADS];
+
+    static char* mapRegion() {
+#ifdef MAP_HUGETLB
+        void* addr = mmap(nullptr, REGION_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (addr != MAP_FAILED) return (char*)addr;
+#endif
+        // Map twice the size and trim, to get a region aligned to 2MB
+        char* raw = (char*)mmap(nullptr, 2*REGION_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (raw == (char*)MAP_FAILED) throw std::bad_alloc();
+        char* aligned = (char*)(((uintptr_t)raw + REGION_SIZE - 1) & ~(REGION_SIZE - 1));
+        if (aligned != raw) munmap(raw, aligned - raw);
+        munmap(aligned + REGION_SIZE, raw + 2*REGION_SIZE - (aligned + REGION_SIZE));
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, REGION_SIZE, MADV_HUGEPAGE);
+#endif
+        return aligned;
+    }
+
+public:
+    // Returns 'size' bytes aligned to 'size'. 'size' must be a power of two, not larger than 2MB
+    char* getSlab(const uint64_t size, const int tid) {
+        Region& r = regions[tid];
+        if (r.cur == r.end) {
+            r.cur = mapRegion();
+            r.end = r.cur + REGION_SIZE;
+        }
+        char* slab = r.cur;
+        r.cur += size;
+        return slab;
+    }
+};
+
+OrcHugePageArena g_orc_hugepage_arena {};
+
+
+/*
+ * <h1> OrcPool </h1>
+ *
+ * Per-thread and per-type pool of objects, used by make_orc<T>() when g_orc_pool_enabled is set.
+ *
+ * Memory is taken from slabs of SLAB_SIZE bytes, aligned to SLAB_SIZE, so that the slab (and
+ * its owner thread) can be found from any object's address by masking the low bits.
+ * Each thread allocates only from its own slabs:
+ * - Objects freed by the owner thread go into its private free list;
+ * - Objects freed by other threads (the thread that won the handover) are grouped per owner and,
+ *   once BATCH of them are gathered, the whole batch is pushed with a single CAS onto the owner's
+ *   'remote' stack. The owner takes the entire remote stack with an exchange() when its private
+ *   free list is empty, therefore there is no ABA problem;
+ * - A partial batch is pushed on the next free of an object of its owner if the owner is 'hungry',
+ *   meaning that it found its free list and its remote stack empty and had to take new memory.
+ *   All the partial batches of a thread are pushed when that thread exits. Therefore, at most
+ *   BATCH-1 objects per (freeing thread, owner) pair are held back, and only while the freeing
+ *   thread is alive;
+ *
+ * With g_orc_pool_hugepages set, the slabs are cut from 2MB huge pages (see OrcHugePageArena).
+ *
+ * The slabs are never returned to the system. Types that are too large (or over-aligned) for
+ * a slab are allocated with 'new' by make_orc<T>(), see OrcPool<T>::fits.
+ *
+ * Progress condition of allocate() and deallocate(): lock-free (wait-free if no remote batch is
+ * pushed or no slab is allocated)
+ */
+template<typename T>
+class OrcPool {
+
+private:
+    static const uint64_t SLAB_SIZE = 64*1024;
+    static const uint64_t HEADER_SIZE = 128;
+    static const int      BATCH = 64;         // Number of remote frees to gather before pushing them to the owner
+    static const uint64_t OBJ_SIZE = ((sizeof(T) + alignof(T) - 1) / alignof(T)) * alignof(T);
+
+    // Intrusive link, stored in the first word of a free object
+    struct FreeObj {
+        FreeObj* next;
+    };
+
+    // Placed at the beginning of each slab
+    struct SlabHeader {
+        int owner;
+    };
+
+    struct PerThread {
+        FreeObj*               freeList {nullptr};
+        char*                  bumpCur {nullptr};                  // Next unused object in the current slab
+        char*                  bumpEnd {nullptr};
+        FreeObj*               pendHead[REGISTRY_MAX_THREADS];     // Objects of other owners waiting to be sent back
+        FreeObj*               pendTail[REGISTRY_MAX_THREADS];
+        int                    pendCount[REGISTRY_MAX_THREADS];
+        alignas(128) std::atomic<FreeObj*> remote {nullptr};       // Batches freed by other threads
+        std::atomic<bool>      hungry {false};                     // Set when the owner had nothing to reuse
+        uint8_t                pad[128];
+
+        PerThread() {
+            for (int i = 0; i < REGISTRY_MAX_THREADS; i++) {
+                pendHead[i] = nullptr;
+                pendTail[i] = nullptr;
+                pendCount[i] = 0;
+            }
+        }
+    };
+
+    // One entry per thread, allocated the first time the thread uses the pool
+    alignas(128) static std::atomic<PerThread*> pools[REGISTRY_MAX_THREADS];
+
+    static inline PerThread* getPool(const int tid) {
+        PerThread* pt = pools[tid].load(std::memory_order_acquire);
+        if (pt != nullptr) return pt;
+        PerThread* newpt = new PerThread();
+        if (pools[tid].compare_exchange_strong(pt, newpt)) return newpt;
+        delete newpt;
+        return pt;
+    }
+
+    static inline int ownerOf(void* obj) {
+        return ((SlabHeader*)((uintptr_t)obj & ~(SLAB_SIZE-1)))->owner;
+    }
+
+    static void newSlab(PerThread* pt, const int tid) {
+        char* slab;
+        if (g_orc_pool_hugepages) {
+            slab = g_orc_hugepage_arena.getSlab(SLAB_SIZE, tid);
+        } else {
+            slab = (char*)std::aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+            if (slab == nullptr) throw std::bad_alloc();
+        }
+        ((SlabHeader*)slab)->owner = tid;
+        pt->bumpCur = slab + HEADER_SIZE;
+        pt->bumpEnd = slab + SLAB_SIZE;
+    }
+
+    static void pushRemote(PerThread* owner, FreeObj* head, FreeObj* tail) {
+        FreeObj* top = owner->remote.load();
+        do {
+            tail->next = top;
+        } while (!owner->remote.compare_exchange_weak(top, head));
+    }
+
+    // Sends the pending batch of 'owner' back to it, even if it is not full
+    static void flushPending(PerThread* pt, const int owner) {
+        pushRemote(getPool(owner), pt->pendHead[owner], pt->pendTail[owner]);
+        pt->pendHead[owner] = nullptr;
+        pt->pendTail[owner] = nullptr;
+        pt->pendCount[owner] = 0;
+    }
+
+    // Flushes all the pending batches of a thread when it exits. Created the first time the thread
+    // has a pending batch, which is after its tid was taken, so this is destroyed before the tid is released
+    struct ExitFlusher {
+        int tid {-1};
+        ~ExitFlusher() {
+            if (tid < 0) return;
+            PerThread* pt = pools[tid].load();
+            for (int owner = 0; owner < REGISTRY_MAX_THREADS; owner++) {
+                if (pt->pendHead[owner] != nullptr) flushPending(pt, owner);
+            }
+        }
+    };
+    static thread_local ExitFlusher exitFlusher;
+
+public:
+    // True if objects of type T can be placed in a slab
+    static const bool fits = (OBJ_SIZE <= (SLAB_SIZE-HEADER_SIZE)/8) && (alignof(T) <= HEADER_SIZE);
+
+    static void* allocate(const int tid) {
+        PerThread* pt = getPool(tid);
+        if (pt->freeList == nullptr && pt->remote.load(std::memory_order_relaxed) != nullptr) {
+            pt->freeList = pt->remote.exchange(nullptr);
+            if (pt->hungry.load(std::memory_order_relaxed)) pt->hungry.store(false, std::memory_order_relaxed);
+        }
+        if (pt->freeList != nullptr) {
+            FreeObj* obj = pt->freeList;
+            pt->freeList = obj->next;
+            return obj;
+        }
+        // Ask the other threads for their partial batches of our objects
+        if (!pt->hungry.load(std::memory_order_relaxed)) pt->hungry.store(true, std::memory_order_relaxed);
+        if (pt->bumpCur + OBJ_SIZE > pt->bumpEnd) newSlab(pt, tid);
+        void* obj = pt->bumpCur;
+        pt->bumpCur += OBJ_SIZE;
+        return obj;
+    }
+
+    // Called from the _deleter, after the destructor of T has been executed
+    static void deallocate(void* ptr, const int tid) {
+        PerThread* pt = getPool(tid);
+        FreeObj* obj = (FreeObj*)ptr;
+        const int owner = ownerOf(ptr);
+        if (owner == tid) {
+            obj->next = pt->freeList;
+            pt->freeList = obj;
+            return;
+        }
+        // Not ours: add to the batch of the owner and send it when full, or when the owner is hungry
+        obj->next = pt->pendHead[owner];
+        if (pt->pendHead[owner] == nullptr) {
+            pt->pendTail[owner] = obj;
+            exitFlusher.tid = tid;
+        }
+        pt->pendHead[owner] = obj;
+        if (++pt->pendCount[owner] < BATCH && !getPool(owner)->hungry.load(std::memory_order_relaxed)) return;
+        flushPending(pt, owner);
+    }
+};
+
+template<typename T>
+alignas(128) std::atomic<typename OrcPool<T>::PerThread*> OrcPool<T>::pools[REGISTRY_MAX_THREADS];
+
+template<typename T>
+thread_local typename OrcPool<T>::ExitFlusher OrcPool<T>::exitFlusher;
+
+} // end of namespace orcgc_ptp
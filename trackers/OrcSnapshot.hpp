@@ -0,0 +1,297 @@
+/*
+ * Copyright 2020
+ *   Andreia Correia <andreia.veiga@unine.ch>
+ *   Pedro Ramalhete <pramalhe@gmail.com>
+ *   Pascal Felber <pascal.felber@unine.ch>
+ *
+ * This work is published under the MIT license. See LICENSE.txt
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "OrcPTP.hpp"
+
+
+/*
+ * <h1> Snapshot policies for range queries </h1>
+ *
+ * These are passed as the 'Snap' template parameter of the data structures that have range queries
+ * (NatarajanTreeOrcGC and HerlihyShavitLockFreeSkipListOrcGC).
+ *
+ * NoSnapshot:  The default. Range queries are not linearizable and nothing is added to the nodes.
+ * OrcSnapshot: Range queries and range counts are linearizable, with a global timestamp and
+ *              per-node insert and delete stamps, in the spirit of the EBR-RQ technique by
+ *              Arbel-Raviv and Brown "Harnessing epoch-based reclamation for efficient range queries":
+ *              https://dl.acm.org/doi/10.1145/3178487.3178489
+ *
+ * How OrcSnapshot works:
+ * - A range query takes ts = clock++ and sees the nodes with itime <= ts and (dtime == 0 or dtime > ts).
+ * - An insert links a node with itime == PENDING and then stamps it with the current clock.
+ *   A remove, after its CAS, sets dtime from 0 to PENDING and then to the current clock, after making
+ *   sure that itime is stamped. Anyone may help a PENDING stamp with the current clock.
+ * - The inserts and removes linearize when their stamp is taken, not at their CAS, like in vCAS by
+ *   Wei et al. "Constant-time snapshots with applications to concurrent data structures":
+ *   https://dl.acm.org/doi/10.1145/3437801.3441602
+ *   For this to hold, no operation may act on a node before its stamps are taken:
+ *   - The point operations that find a node call present(), which stamps itime before saying yes.
+ *     A dtime of 0 means the remove is not linearized yet, and the node is still in the set.
+ *   - A node that is known to be removed (its link is marked) must be passed to helpRemoved() before
+ *     it is unlinked or reported as absent, otherwise an operation that no longer finds it could
+ *     complete before its dtime is taken.
+ *   The clock is read after PENDING is stored, therefore a dtime of 0 seen by a range query means the
+ *   node will get a stamp larger than ts, and it is visible.
+ * - A removed node may be unlinked before a range query gets to it. Before its linearizing CAS, the
+ *   remover announces the node in announce[tid], and after stamping, it moves it to its own limbo list,
+ *   if there is any range query active. The range queries look at the announcements and then the limbo
+ *   lists, after traversing the data structure.
+ * - The limbo lists hold an orc reference to each removed node, which means it can not be reclaimed
+ *   until it is pruned from the list, and it is pruned only when its dtime is not larger than the ts
+ *   of the oldest active range query. The last snapshot to end prunes the lists of all the threads,
+ *   and so does each thread on its own list when it removes a node while no snapshot is active.
+ * - When a remove in the tree is done by replacing a leaf with a new one (put() and replace()), the new
+ *   leaf points to the old one in 'replaces' until it is stamped, and its itime is the dtime of the old one.
+ *
+ * Each thread can have at most one snapshot active at a time.
+ */
+namespace orcgc_ptp {
+
+struct NoSnapshot {
+    static const bool enabled = false;
+
+    template<typename Node> struct Stamps { };
+
+    template<typename Node> struct Domain {
+        inline uint64_t begin() { return 0; }
+        inline void end() { }
+        inline void announce(Node*) { }
+        inline void unannounce() { }
+        inline void inserted(Node*) { }
+        inline void removed(Node*) { }
+        inline void setReplaces(Node*, Node*) { }
+        inline void replaced(Node*, Node*) { }
+        inline bool present(Node*) { return true; }
+        inline void helpRemoved(Node*) { }
+        inline uint64_t now() { return 0; }
+        inline void prestamp(Node*, uint64_t) { }
+        inline bool visible(Node*, uint64_t) { return true; }
+        template<typename F> inline void forEachRemoved(uint64_t, F) { }
+    };
+
+    static std::string suffix() { return ""; }
+};
+
+
+struct OrcSnapshot {
+    static const bool enabled = true;
+    static const uint64_t PENDING = ~0ULL;
+
+    template<typename Node> struct Stamps {
+        std::atomic<uint64_t> itime {PENDING};   // Insert stamp
+        std::atomic<uint64_t> dtime {0};         // Delete stamp. Zero means not removed (yet)
+        orc_atomic<Node*>     replaces {nullptr}; // Node that this one replaced, until itime is stamped
+    };
+
+    template<typename Node> struct Domain {
+        static const int CLPAD = 128/sizeof(uint64_t);
+        static const int PRUNE_PERIOD = 32;     // Number of nodes added to a limbo list between prunes
+
+        struct LimboEntry : orc_base {
+            uint64_t                dtime;
+            orc_atomic<Node*>       node;
+            orc_atomic<LimboEntry*> next {nullptr};
+            LimboEntry(uint64_t dtime, Node* node) : dtime{dtime}, node{node} { }
+        };
+
+        struct alignas(128) PerThread {
+            orc_atomic<Node*>       announce {nullptr};
+            orc_atomic<LimboEntry*> limbo {nullptr};
+            int                     pushes {0};
+        };
+
+        alignas(128) std::atomic<uint64_t> clock {1};
+        alignas(128) std::atomic<int64_t>  numActive {0};
+        alignas(128) std::atomic<uint64_t> active[REGISTRY_MAX_THREADS*CLPAD];  // ts lower bound of each thread's snapshot, or 0
+        PerThread                          tl[REGISTRY_MAX_THREADS];
+
+        Domain() {
+            for (int it = 0; it < REGISTRY_MAX_THREADS; it++) active[it*CLPAD].store(0, std::memory_order_relaxed);
+        }
+
+        // Starts a snapshot and returns its timestamp
+        uint64_t begin() {
+            const int tid = ThreadRegistry::getTID();
+            numActive.fetch_add(1);
+            // Announce a lower bound of ts before taking it, so that prune() never goes above it
+            active[tid*CLPAD].store(clock.load());
+            return clock.fetch_add(1);
+        }
+
+        void end() {
+            const int tid = ThreadRegistry::getTID();
+            active[tid*CLPAD].store(0, std::memory_order_release);
+            if (numActive.fetch_add(-1) != 1) {
+                prune(tid);
+                return;
+            }
+            // Last active snapshot: the other threads may not push (and prune) again for a long time
+            const int maxThreads = (int)ThreadRegistry::getMaxThreads();
+            for (int it = 0; it < maxThreads; it++) prune(it);
+        }
+
+        // Called before the CAS that removes 'node'. It stays announced until removed() or unannounce()
+        inline void announce(Node* node) {
+            tl[ThreadRegistry::getTID()].announce.store(node);
+        }
+
+        inline void unannounce() {
+            tl[ThreadRegistry::getTID()].announce.store(nullptr);
+        }
+
+        // Called after the CAS that links 'node'
+        inline void inserted(Node* node) {
+            stampInsert(node);
+        }
+
+        // Called after the CAS that removes 'node', which must have been announced
+        void removed(Node* node) {
+            const uint64_t d = stampDelete(node);
+            addToLimbo(node, d);
+        }
+
+        // Called before the CAS that replaces 'oldNode' with 'newNode', while 'newNode' is not yet visible
+        inline void setReplaces(Node* newNode, Node* oldNode) {
+            newNode->replaces.store(oldNode);
+        }
+
+        // Called after the CAS that replaced 'oldNode' with 'newNode'. 'oldNode' must have been announced
+        void replaced(Node* newNode, Node* oldNode) {
+            const uint64_t d = stampInsert(newNode);
+            newNode->replaces.store(nullptr);
+            addToLimbo(oldNode, d);
+        }
+
+        // Called by the point operations on a node they found linked. Returns true if it is in the set
+        inline bool present(Node* node) {
+            stampInsert(node);
+            const uint64_t d = node->dtime.load();
+            if (d == 0) return true;
+            if (d == PENDING) helpStamp(node->dtime);
+            return false;
+        }
+
+        // Called on a node that is known to be removed, before unlinking it or reporting it as absent
+        inline void helpRemoved(Node* node) {
+            stampDelete(node);
+        }
+
+        // Stamp for the nodes of a bulk load, to be read once before any of them is published
+        inline uint64_t now() {
+            return clock.load();
+        }
+
+        // Sets the insert stamp of a node that is not yet visible. The CAS that publishes it is the release
+        inline void prestamp(Node* node, uint64_t stamp) {
+            node->itime.store(stamp, std::memory_order_relaxed);
+        }
+
+        // Returns true if 'node' is in the snapshot 'ts'. Helps the stamps that are PENDING.
+        bool visible(Node* node, uint64_t ts) {
+            if (stampInsert(node) > ts) return false;
+            uint64_t d = node->dtime.load();
+            if (d == PENDING) d = helpStamp(node->dtime);
+            return d == 0 || d > ts;
+        }
+
+        // Calls visitor(Node*) on the announced nodes and then on the nodes in limbo that may be visible in 'ts'
+        template<typename F> void forEachRemoved(uint64_t ts, F visitor) {
+            const int maxThreads = (int)ThreadRegistry::getMaxThreads();
+            orc_ptr<Node*> node;
+            for (int it = 0; it < maxThreads; it++) {
+                node = tl[it].announce.load();
+                if (node != nullptr) visitor((Node*)node);
+            }
+            orc_ptr<LimboEntry*> entry;
+            for (int it = 0; it < maxThreads; it++) {
+                entry = tl[it].limbo.load();
+                // The entries are ordered by decreasing dtime
+                while (entry != nullptr && entry->dtime > ts) {
+                    node = entry->node.load();
+                    visitor((Node*)node);
+                    entry = entry->next.load();
+                }
+            }
+        }
+
+    private:
+        inline uint64_t helpStamp(std::atomic<uint64_t>& stamp) {
+            uint64_t s = PENDING;
+            stamp.compare_exchange_strong(s, clock.load());
+            return stamp.load();
+        }
+
+        uint64_t stampInsert(Node* node) {
+            uint64_t i = node->itime.load();
+            if (i != PENDING) return i;
+            orc_ptr<Node*> oldNode = node->replaces.load();
+            if (oldNode != nullptr) {
+                // The insert of 'node' is the remove of 'oldNode'
+                i = PENDING;
+                node->itime.compare_exchange_strong(i, stampDelete(oldNode));
+                return node->itime.load();
+            }
+            return helpStamp(node->itime);
+        }
+
+        // Only for nodes that are known to be removed. The insert is stamped first so that itime <= dtime
+        uint64_t stampDelete(Node* node) {
+            stampInsert(node);
+            uint64_t d = 0;
+            // The clock must be read after PENDING is visible
+            node->dtime.compare_exchange_strong(d, PENDING);
+            return helpStamp(node->dtime);
+        }
+
+        void addToLimbo(Node* node, uint64_t d) {
+            const int tid = ThreadRegistry::getTID();
+            // Any snapshot that starts after this will have ts >= d, and doesn't need 'node'
+            if (numActive.load() != 0) {
+                orc_ptr<LimboEntry*> entry = make_orc<LimboEntry>(d, node);
+                entry->next = tl[tid].limbo;
+                tl[tid].limbo.store(entry);
+                if (++tl[tid].pushes % PRUNE_PERIOD == 0) prune(tid);
+            } else if (tl[tid].limbo.load() != nullptr) {
+                // Left over from the snapshots that have ended, don't keep the nodes pinned until the next one
+                prune(tid);
+            }
+            tl[tid].announce.store(nullptr);
+        }
+
+        // Cuts the entries of the limbo list of 'tid' that no active snapshot can see.
+        // It may be called on the list of another thread: the threshold is at most the ts of any snapshot
+        // that starts later, and if the owner pushes at the same time the cut entries are only kept longer.
+        void prune(const int tid) {
+            uint64_t threshold = clock.load();
+            const int maxThreads = (int)ThreadRegistry::getMaxThreads();
+            for (int it = 0; it < maxThreads; it++) {
+                const uint64_t ats = active[it*CLPAD].load();
+                if (ats != 0 && ats < threshold) threshold = ats;
+            }
+            orc_ptr<LimboEntry*> prev;
+            orc_ptr<LimboEntry*> entry = tl[tid].limbo.load();
+            while (entry != nullptr && entry->dtime > threshold) {
+                prev = entry;
+                entry = entry->next.load();
+            }
+            if (entry == nullptr) return;
+            if (prev == nullptr) tl[tid].limbo.store(nullptr);
+            else prev->next.store(nullptr);
+        }
+    };
+
+    static std::string suffix() { return "-Snapshot"; }
+};
+
+} // end of namespace orcgc_ptp
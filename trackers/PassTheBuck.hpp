@@ -12,6 +12,7 @@
 #include <iostream>
 #include <vector>
 #include "common/ThreadRegistry.hpp"
+#include "HPScan.hpp"
 
 // DCAS / CAS2 macro
 #define DCAS(ptr, o1, o2, n1, n2)                               \
@@ -45,6 +46,7 @@ class PassTheBuck {
 private:
     static const int                HP_MAX_HPS = 16;     // This is named 'K' in the HP paper
     static const int                CLPAD = 128/sizeof(std::atomic<T*>);
+    static const bool               useVectorScan = true; // Search the ValueSet with hpscan_find() (see HPScan.hpp)
     const int                       maxHPs;
 
     alignas(128) std::atomic<T*>   hp[REGISTRY_MAX_THREADS][HP_MAX_HPS];         // This is named POST[] in the paper
@@ -62,6 +64,7 @@ private:
         }
 
         inline bool search(T* v) {
+            if (useVectorScan) return hpscan_find(set, index, v) >= 0;
             for (int i = 0; i < index; i++) if (set[i] == v) return true;
             return false;
         }
@@ -12,6 +12,7 @@
 #include <iostream>
 #include <vector>
 #include "common/ThreadRegistry.hpp"
+#include "HPScan.hpp"
 
 
 /*
@@ -41,6 +42,7 @@ class PassThePointer {
 
 private:
     static const int                HP_MAX_HPS = 32;     // This is named 'K' in the HP paper
+    static const bool               useVectorScan = true; // Look for candidate slots with hpscan_find() (see HPScan.hpp)
     const int                       maxHPs;
 
     alignas(128) std::atomic<T*>    hp[REGISTRY_MAX_THREADS][HP_MAX_HPS];
@@ -54,6 +56,12 @@ private:
         if (ptr == nullptr) return;
         for (int it = start; it < maxThreads; it++) {
             for (int ihp = 0; ihp < maxHPs; ) {
+                if (useVectorScan) {
+                    // Skip ahead to the next slot that may have 'ptr'. It is re-checked below with a load()
+                    const int found = hpscan_find(&hp[it][ihp], maxHPs - ihp, ptr);
+                    if (found < 0) break;
+                    ihp += found;
+                }
                 // TODO: We may want to deal with the case where the hp.load() changes at the
                 // same time as handovers.exchange(). Maybe return handovers.exchange(nullptr).
                 // Notice it is not needed for correctness or memory bound, but it would be